@@ -0,0 +1,378 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <nlohmann/json.hpp>
+#include "profiler.cpp"
+#include "trainer.cpp"
+#include "evaluator.cpp"
+#include "datahandler.cpp"
+
+// Heap accounting. On glibc, malloc and friends are interposed (the real allocator is reached
+// through its __libc_* entry points), so allocations from operator new, Eigen's aligned_malloc and
+// plain std::malloc are all counted. liveHeapBytes uses malloc_usable_size, so it includes allocator
+// rounding but not per-chunk headers or fragmentation. Elsewhere there are no hooks and the report
+// carries null for the allocation and heap figures.
+std::atomic<uint64_t> allocationCount{0};
+std::atomic<int64_t> liveHeapBytes{0};
+std::atomic<int64_t> peakHeapBytes{0};
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+const bool kHeapAccounting = true;
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+void trackAllocation(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  int64_t live = liveHeapBytes.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed) + malloc_usable_size(ptr);
+  int64_t peak = peakHeapBytes.load(std::memory_order_relaxed);
+  while (live > peak && !peakHeapBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+  }
+}
+
+void trackFree(void* ptr) {
+  if (ptr) {
+    liveHeapBytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+  }
+}
+
+extern "C" {
+void* malloc(size_t size) {
+  void* ptr = __libc_malloc(size);
+  trackAllocation(ptr);
+  return ptr;
+}
+
+void* calloc(size_t count, size_t size) {
+  void* ptr = __libc_calloc(count, size);
+  trackAllocation(ptr);
+  return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+  size_t oldSize = ptr ? malloc_usable_size(ptr) : 0;
+  void* result = __libc_realloc(ptr, size);
+  if (result) {
+    liveHeapBytes.fetch_sub(oldSize, std::memory_order_relaxed);
+    trackAllocation(result);
+  } else if (size == 0) {
+    liveHeapBytes.fetch_sub(oldSize, std::memory_order_relaxed);
+  }
+  return result;
+}
+
+void* memalign(size_t alignment, size_t size) {
+  void* ptr = __libc_memalign(alignment, size);
+  trackAllocation(ptr);
+  return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) {
+  if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  void* ptr = memalign(alignment, size);
+  if (!ptr) {
+    return ENOMEM;
+  }
+  *result = ptr;
+  return 0;
+}
+
+void free(void* ptr) {
+  trackFree(ptr);
+  __libc_free(ptr);
+}
+}
+#else
+const bool kHeapAccounting = false;
+#endif
+
+long peakRssKilobytes() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Current (not peak) resident set size, so per-benchmark deltas are meaningful.
+long currentRssKilobytes() {
+  std::ifstream statm("/proc/self/statm");
+  long totalPages = 0;
+  long residentPages = 0;
+  statm >> totalPages >> residentPages;
+  return residentPages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+struct BenchmarkScale {
+  std::string name;
+  size_t samples;
+};
+
+// Percentile of an unsorted sample, or null when there are too few samples for it to mean anything
+// (p90 needs at least 10 samples, p99 at least 100, ...): with 5 samples every upper percentile is
+// just the maximum.
+nlohmann::json samplePercentile(std::vector<double> samples, double p) {
+  if (samples.empty() || samples.size() < 1.0 / (1.0 - p / 100.0) - 1e-9) {
+    return nullptr;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t rank = static_cast<size_t>(p / 100.0 * (samples.size() - 1));
+  return samples[rank];
+}
+
+nlohmann::json latencyJson(const std::vector<double>& samples, double scale) {
+  nlohmann::json latency = nlohmann::json::object();
+  for (double p : {50.0, 90.0, 99.0, 99.9}) {
+    nlohmann::json value = samplePercentile(samples, p);
+    std::string key = p == 99.9 ? "p99.9" : "p" + std::to_string(static_cast<int>(p));
+    latency[key] = value.is_null() ? value : nlohmann::json(value.get<double>() * scale);
+  }
+  return latency;
+}
+
+struct BenchmarkResult {
+  std::string name;
+  std::string scale;
+  size_t items = 0;
+  std::vector<double> secondsPerIteration;
+  std::vector<double> secondsPerCall; // per-call latency benchmarks only
+  uint64_t allocationsPerIteration = 0;
+  long peakHeapKb = 0;
+  long rssDeltaKb = 0;
+
+  double medianSeconds() const {
+    std::vector<double> sorted = secondsPerIteration;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[sorted.size() / 2];
+  }
+
+  nlohmann::json toJson() const {
+    double median = medianSeconds();
+    nlohmann::json json = {
+        {"name", name},
+        {"scale", scale},
+        {"items", items},
+        {"iterations", secondsPerIteration.size()},
+        {"items_per_second", median > 0 ? items / median : 0.0},
+        {"iteration_ms", latencyJson(secondsPerIteration, 1e3)},
+        {"allocations_per_iteration", kHeapAccounting ? nlohmann::json(allocationsPerIteration) : nlohmann::json()},
+        {"peak_heap_kb", kHeapAccounting ? nlohmann::json(peakHeapKb) : nlohmann::json()},
+        {"rss_delta_kb", rssDeltaKb},
+    };
+    if (!secondsPerCall.empty()) {
+      json["calls"] = secondsPerCall.size();
+      json["call_latency_us"] = latencyJson(secondsPerCall, 1e6);
+    }
+    return json;
+  }
+};
+
+// Runs body once to warm up, then repeatedly until it has at least kMinIterations timed runs and
+// kMinSeconds of samples (capped at kMaxIterations). Setup work belongs outside body. peak_heap_kb
+// is the heap high-water mark above what was live before the benchmark started.
+const int kMinIterations = 5;
+const int kMaxIterations = 1000;
+const double kMinSeconds = 1.0;
+
+BenchmarkResult runBenchmark(const std::string& name, const BenchmarkScale& scale, size_t items,
+                             const std::function<void()>& body) {
+  BenchmarkResult result;
+  result.name = name;
+  result.scale = scale.name;
+  result.items = items;
+
+  long rssBefore = currentRssKilobytes();
+  int64_t liveBefore = liveHeapBytes.load();
+  peakHeapBytes.store(liveBefore);
+
+  body();
+  uint64_t allocationsBefore = allocationCount.load();
+  double totalSeconds = 0;
+  while (static_cast<int>(result.secondsPerIteration.size()) < kMaxIterations &&
+         (static_cast<int>(result.secondsPerIteration.size()) < kMinIterations || totalSeconds < kMinSeconds)) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.secondsPerIteration.push_back(seconds);
+    totalSeconds += seconds;
+  }
+  result.allocationsPerIteration = (allocationCount.load() - allocationsBefore) / result.secondsPerIteration.size();
+  result.peakHeapKb = (peakHeapBytes.load() - liveBefore) / 1024;
+  result.rssDeltaKb = currentRssKilobytes() - rssBefore;
+
+  std::cerr << name << " [" << scale.name << "]: " << items / result.medianSeconds() << " items/s over "
+            << result.secondsPerIteration.size() << " iterations" << std::endl;
+  return result;
+}
+
+// Times every call separately, so the latency percentiles come from `calls` samples rather than from
+// a handful of whole-dataset iterations. One iteration is one pass over all calls; samples are kept
+// for the warm-up plus the first kMinIterations passes, in storage reserved up front so recording
+// them does not show up in the allocation counts.
+BenchmarkResult runLatencyBenchmark(const std::string& name, const BenchmarkScale& scale, size_t calls,
+                                    const std::function<void(size_t)>& call) {
+  std::vector<double> secondsPerCall;
+  secondsPerCall.reserve(calls * (kMinIterations + 1));
+  BenchmarkResult result = runBenchmark(name, scale, calls, [&] {
+    for (size_t i = 0; i < calls; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      call(i);
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      if (secondsPerCall.size() < secondsPerCall.capacity()) {
+        secondsPerCall.push_back(seconds);
+      }
+    }
+  });
+  // Drop the warm-up pass.
+  secondsPerCall.erase(secondsPerCall.begin(), secondsPerCall.begin() + calls);
+  result.secondsPerCall = std::move(secondsPerCall);
+  return result;
+}
+
+// Synthetic data generators. Seeds are fixed so runs are comparable.
+
+void generateCsvFile(const std::string& filename, size_t rows, int numFeatures, std::mt19937& gen) {
+  std::uniform_real_distribution<double> distribution(0.0, 100.0);
+  std::ofstream outfile(filename);
+  for (int i = 0; i < numFeatures; ++i) {
+    outfile << (i ? "," : "") << "feature" << i;
+  }
+  outfile << "\n";
+  // loadDataFromCSV expects each feature row to be followed by its target row.
+  for (size_t row = 0; row < rows; ++row) {
+    for (int i = 0; i < numFeatures; ++i) {
+      outfile << (i ? "," : "") << distribution(gen);
+    }
+    outfile << "\n" << distribution(gen) << "\n";
+  }
+}
+
+std::vector<DataPoint> generateDataPoints(size_t count, std::mt19937& gen) {
+  std::uniform_int_distribution<int> distribution(1, 100);
+  std::vector<DataPoint> dataPoints(count);
+  for (DataPoint& point : dataPoints) {
+    point.raw_value = distribution(gen);
+  }
+  return furtherPreprocess(dataPoints);
+}
+
+std::vector<std::vector<double>> generateDataVectors(size_t count, int dimension, std::mt19937& gen) {
+  std::uniform_real_distribution<double> distribution(0.0, 1.0);
+  std::vector<std::vector<double>> dataVectors(count, std::vector<double>(dimension));
+  for (auto& dataVector : dataVectors) {
+    for (double& value : dataVector) {
+      value = distribution(gen);
+    }
+  }
+  return dataVectors;
+}
+
+int main(int argc, char** argv) {
+  // Usage: benchmark [report.json] [--profile profile.json]
+  std::string reportPath = "benchmark_report.json";
+  std::string profilePath;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--profile" && i + 1 < argc) {
+      profilePath = argv[++i];
+    } else {
+      reportPath = arg;
+    }
+  }
+  if (!profilePath.empty()) {
+    Profiler::instance().enable();
+  }
+
+  const std::vector<BenchmarkScale> scales = {{"small", 1000}, {"medium", 10000}, {"large", 100000}};
+  const int numFeatures = 16;
+  const int vectorDimension = 64;
+  const std::vector<int> documentFrequencies(100, 10);
+
+  std::mt19937 gen(42);
+  nlohmann::json results = nlohmann::json::array();
+
+  for (const BenchmarkScale& scale : scales) {
+    std::string csvPath = "benchmark_" + scale.name + ".csv";
+    generateCsvFile(csvPath, scale.samples, numFeatures, gen);
+    results.push_back(runBenchmark("loadDataFromCSV", scale, scale.samples, [&] {
+      datahandler::loadDataFromCSV(csvPath);
+    }).toJson());
+    std::remove(csvPath.c_str());
+
+    std::vector<DataPoint> dataPoints = generateDataPoints(scale.samples, gen);
+    results.push_back(runBenchmark("vectorizeDataRandomProjection", scale, scale.samples, [&] {
+      vectorizeDataRandomProjection(dataPoints, vectorDimension, documentFrequencies);
+    }).toJson());
+
+    std::vector<std::vector<double>> dataVectors = generateDataVectors(scale.samples, vectorDimension, gen);
+    std::vector<std::vector<double>> targets = generateDataVectors(scale.samples, 1, gen);
+    results.push_back(runBenchmark("constructMerkleTree", scale, scale.samples, [&] {
+      constructMerkleTree(dataVectors);
+    }).toJson());
+
+    NeuralNetwork net(vectorDimension, {32}, 1, std::make_unique<ReLU>());
+    results.push_back(runBenchmark("NeuralNetwork::train", scale, scale.samples, [&] {
+      net.train(dataVectors, targets, 0.01);
+    }).toJson());
+
+    results.push_back(runLatencyBenchmark("NeuralNetwork::predict", scale, scale.samples, [&](size_t i) {
+      net.predict(dataVectors[i]);
+    }).toJson());
+
+    SGD optimizer;
+    results.push_back(runBenchmark("trainNetwork", scale, scale.samples, [&] {
+      trainNetwork(net, dataVectors, targets, optimizer, /* batch size */ 32, /* learning rate */ 0.01);
+    }).toJson());
+
+    std::vector<NeuralNetwork> networks;
+    networks.emplace_back(vectorDimension, std::vector<int>{32}, 1, std::make_unique<ReLU>());
+    results.push_back(runBenchmark("evaluateNetworks", scale, scale.samples, [&] {
+      computeNetworkEvaluations(networks, dataVectors, targets);
+    }).toJson());
+  }
+
+  nlohmann::json report = {{"benchmarks", results}, {"process_peak_rss_kb", peakRssKilobytes()}};
+  if (Profiler::instance().isEnabled()) {
+    report["profile"] = Profiler::instance().toJson();
+  }
+
+  std::ofstream outfile(reportPath);
+  if (!outfile.is_open()) {
+    std::cerr << "Error: Could not open file for writing." << std::endl;
+    return 1;
+  }
+  outfile << report.dump(2) << std::endl;
+  std::cout << "Benchmark report written to file: " << reportPath << std::endl;
+
+  if (!profilePath.empty()) {
+    Profiler::instance().dumpJson(profilePath);
+  }
+
+  return 0;
+}
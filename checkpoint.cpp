@@ -0,0 +1,459 @@
+#ifndef CHECKPOINT_CPP
+#define CHECKPOINT_CPP
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <stdexcept>
+#include <future>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <Eigen/Dense>
+#include "neuralnetworkbeta.cpp"
+
+// On-disk layout (all integers little-endian, every blob 64-byte aligned):
+//   CheckpointHeader | CheckpointLayerRecord[layerCount] | CheckpointBufferRecord[optimizerBufferCount] | blobs...
+// Weights are stored column-major, exactly as Eigen::MatrixXd keeps them in memory,
+// so a mapped file can be used directly without any parsing or copying.
+// Records and blobs are written and mapped in native byte order, so the format is only defined for
+// little-endian hosts; building elsewhere is a compile error rather than silently unreadable files.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Checkpoint format requires a little-endian host");
+
+const char kCheckpointMagic[8] = {'M', 'L', 'X', 'C', 'K', 'P', 'T', '\0'};
+const uint32_t kCheckpointVersion = 1;
+const size_t kCheckpointAlignment = 64;
+
+enum class ActivationType : uint32_t { SIGMOID, RELU };
+
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t layerCount;
+  uint64_t inputSize;
+  uint64_t optimizerStep;
+  uint64_t optimizerBufferCount;
+  uint64_t fileSize;
+  char checksum[64]; // Hex SHA-256 of everything after the header
+  char reserved[16];
+};
+static_assert(sizeof(CheckpointHeader) % kCheckpointAlignment == 0, "Header must keep blobs aligned");
+
+struct CheckpointLayerRecord {
+  uint32_t inputSize;
+  uint32_t outputSize;
+  uint32_t activation;
+  uint32_t reserved;
+  uint64_t weightsOffset;
+  uint64_t biasesOffset;
+};
+
+struct CheckpointBufferRecord {
+  uint64_t offset;
+  uint64_t count;
+};
+
+struct OptimizerState {
+  uint64_t step = 0;
+  std::vector<std::vector<double>> buffers; // e.g. per-layer moment estimates
+};
+
+size_t alignCheckpointOffset(size_t offset) {
+  return (offset + kCheckpointAlignment - 1) / kCheckpointAlignment * kCheckpointAlignment;
+}
+
+ActivationType activationTypeOf(const ActivationFunction& activation) {
+  if (dynamic_cast<const Sigmoid*>(&activation)) {
+    return ActivationType::SIGMOID;
+  }
+  if (dynamic_cast<const ReLU*>(&activation)) {
+    return ActivationType::RELU;
+  }
+  throw std::runtime_error("Unsupported activation function for checkpointing");
+}
+
+std::unique_ptr<ActivationFunction> makeActivation(ActivationType type) {
+  switch (type) {
+    case ActivationType::SIGMOID:
+      return std::make_unique<Sigmoid>();
+    case ActivationType::RELU:
+      return std::make_unique<ReLU>();
+  }
+  throw std::runtime_error("Unknown activation type in checkpoint");
+}
+
+std::string checkpointChecksum(const unsigned char* data, size_t length) {
+  return hashBytes(reinterpret_cast<const byte*>(data) + sizeof(CheckpointHeader), length - sizeof(CheckpointHeader));
+}
+
+// Lays out the network and optimizer state into a buffer. The checksum is left empty so that
+// the (comparatively slow) hashing can happen off the training thread, see finalizeCheckpoint.
+std::vector<unsigned char> serializeCheckpoint(const NeuralNetwork& net, const OptimizerState& state) {
+  size_t offset = sizeof(CheckpointHeader);
+  size_t layerTableOffset = offset;
+  offset = alignCheckpointOffset(offset + net.layers.size() * sizeof(CheckpointLayerRecord));
+  size_t bufferTableOffset = offset;
+  offset = alignCheckpointOffset(offset + state.buffers.size() * sizeof(CheckpointBufferRecord));
+
+  std::vector<CheckpointLayerRecord> layerRecords;
+  layerRecords.reserve(net.layers.size());
+  for (const auto& layer : net.layers) {
+    CheckpointLayerRecord record = {};
+    record.inputSize = static_cast<uint32_t>(layer->weights.cols());
+    record.outputSize = static_cast<uint32_t>(layer->weights.rows());
+    record.activation = static_cast<uint32_t>(activationTypeOf(*layer->activation));
+    record.weightsOffset = offset;
+    offset = alignCheckpointOffset(offset + layer->weights.size() * sizeof(double));
+    record.biasesOffset = offset;
+    offset = alignCheckpointOffset(offset + layer->biases.size() * sizeof(double));
+    layerRecords.push_back(record);
+  }
+
+  std::vector<CheckpointBufferRecord> bufferRecords;
+  bufferRecords.reserve(state.buffers.size());
+  for (const auto& buffer : state.buffers) {
+    bufferRecords.push_back({offset, buffer.size()});
+    offset = alignCheckpointOffset(offset + buffer.size() * sizeof(double));
+  }
+
+  std::vector<unsigned char> data(offset, 0);
+
+  CheckpointHeader header = {};
+  std::memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+  header.version = kCheckpointVersion;
+  header.layerCount = static_cast<uint32_t>(net.layers.size());
+  header.inputSize = net.inputSize;
+  header.optimizerStep = state.step;
+  header.optimizerBufferCount = state.buffers.size();
+  header.fileSize = data.size();
+  std::memcpy(data.data(), &header, sizeof(header));
+
+  if (!layerRecords.empty()) {
+    std::memcpy(data.data() + layerTableOffset, layerRecords.data(), layerRecords.size() * sizeof(CheckpointLayerRecord));
+  }
+  if (!bufferRecords.empty()) {
+    std::memcpy(data.data() + bufferTableOffset, bufferRecords.data(), bufferRecords.size() * sizeof(CheckpointBufferRecord));
+  }
+
+  for (size_t i = 0; i < net.layers.size(); ++i) {
+    const auto& layer = net.layers[i];
+    std::memcpy(data.data() + layerRecords[i].weightsOffset, layer->weights.data(), layer->weights.size() * sizeof(double));
+    std::memcpy(data.data() + layerRecords[i].biasesOffset, layer->biases.data(), layer->biases.size() * sizeof(double));
+  }
+  for (size_t i = 0; i < state.buffers.size(); ++i) {
+    std::memcpy(data.data() + bufferRecords[i].offset, state.buffers[i].data(), state.buffers[i].size() * sizeof(double));
+  }
+
+  return data;
+}
+
+void finalizeCheckpoint(std::vector<unsigned char>& data) {
+  std::string checksum = checkpointChecksum(data.data(), data.size());
+  std::memcpy(data.data() + offsetof(CheckpointHeader, checksum), checksum.data(), sizeof(CheckpointHeader::checksum));
+}
+
+// Writes to a temporary file, fsyncs it and renames it over the target, then fsyncs the directory,
+// so after a crash the checkpoint is either the old one or the complete new one, never partial.
+void writeCheckpointFile(const std::vector<unsigned char>& data, const std::string& filename) {
+  std::string tempFilename = filename + ".tmp";
+  int fd = open(tempFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open checkpoint file for writing: " + tempFilename);
+  }
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n = write(fd, data.data() + written, data.size() - written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      close(fd);
+      std::remove(tempFilename.c_str());
+      throw std::runtime_error("Failed to write checkpoint file: " + tempFilename);
+    }
+    written += n;
+  }
+  if (fsync(fd) != 0 || close(fd) != 0) {
+    std::remove(tempFilename.c_str());
+    throw std::runtime_error("Failed to flush checkpoint file: " + tempFilename);
+  }
+  if (std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+    throw std::runtime_error("Failed to move checkpoint into place: " + filename);
+  }
+
+  // Persist the rename itself. Failing to open the directory is not fatal: the data is on disk.
+  size_t slash = filename.find_last_of('/');
+  std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : filename.substr(0, slash));
+  int directoryFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (directoryFd >= 0) {
+    fsync(directoryFd);
+    close(directoryFd);
+  }
+}
+
+void saveCheckpoint(const NeuralNetwork& net, const OptimizerState& state, const std::string& filename) {
+  std::vector<unsigned char> data = serializeCheckpoint(net, state);
+  finalizeCheckpoint(data);
+  writeCheckpointFile(data, filename);
+}
+
+const CheckpointHeader& parseCheckpointHeader(const unsigned char* data, size_t length) {
+  if (length < sizeof(CheckpointHeader)) {
+    throw std::runtime_error("Checkpoint is truncated");
+  }
+  const CheckpointHeader& header = *reinterpret_cast<const CheckpointHeader*>(data);
+  if (std::memcmp(header.magic, kCheckpointMagic, sizeof(header.magic)) != 0) {
+    throw std::runtime_error("Not a checkpoint file");
+  }
+  if (header.version != kCheckpointVersion) {
+    throw std::runtime_error("Unsupported checkpoint version: " + std::to_string(header.version));
+  }
+  if (header.fileSize != length) {
+    throw std::runtime_error("Checkpoint size does not match its header");
+  }
+  // The buffer table starts at the aligned end of the layer table, see checkpointBufferRecords.
+  size_t bufferTableOffset = alignCheckpointOffset(sizeof(CheckpointHeader) + header.layerCount * sizeof(CheckpointLayerRecord));
+  if (bufferTableOffset > length ||
+      header.optimizerBufferCount > (length - bufferTableOffset) / sizeof(CheckpointBufferRecord)) {
+    throw std::runtime_error("Checkpoint tables exceed file size");
+  }
+  return header;
+}
+
+void verifyCheckpointChecksum(const unsigned char* data, size_t length) {
+  const CheckpointHeader& header = *reinterpret_cast<const CheckpointHeader*>(data);
+  std::string checksum = checkpointChecksum(data, length);
+  if (checksum.compare(0, checksum.size(), header.checksum, sizeof(header.checksum)) != 0) {
+    throw std::runtime_error("Checkpoint checksum mismatch");
+  }
+}
+
+const CheckpointLayerRecord* checkpointLayerRecords(const unsigned char* data) {
+  return reinterpret_cast<const CheckpointLayerRecord*>(data + sizeof(CheckpointHeader));
+}
+
+const CheckpointBufferRecord* checkpointBufferRecords(const unsigned char* data, const CheckpointHeader& header) {
+  size_t offset = alignCheckpointOffset(sizeof(CheckpointHeader) + header.layerCount * sizeof(CheckpointLayerRecord));
+  return reinterpret_cast<const CheckpointBufferRecord*>(data + offset);
+}
+
+void checkBlobBounds(uint64_t offset, uint64_t count, size_t length) {
+  if (offset % kCheckpointAlignment != 0 || offset > length || count > (length - offset) / sizeof(double)) {
+    throw std::runtime_error("Checkpoint blob out of bounds");
+  }
+}
+
+// Checks every layer's blobs are in bounds and that consecutive layer shapes chain together,
+// so a corrupt file is rejected here instead of reaching Eigen with mismatched dimensions.
+void validateCheckpointLayers(const unsigned char* data, size_t length, const CheckpointHeader& header) {
+  const CheckpointLayerRecord* records = checkpointLayerRecords(data);
+  uint64_t expectedInputSize = header.inputSize;
+  for (uint32_t i = 0; i < header.layerCount; ++i) {
+    const CheckpointLayerRecord& record = records[i];
+    if (record.inputSize != expectedInputSize || record.outputSize == 0) {
+      throw std::runtime_error("Checkpoint layer " + std::to_string(i) + " has an inconsistent shape");
+    }
+    checkBlobBounds(record.weightsOffset, uint64_t(record.inputSize) * record.outputSize, length);
+    checkBlobBounds(record.biasesOffset, record.outputSize, length);
+    expectedInputSize = record.outputSize;
+  }
+}
+
+// Loads a checkpoint into a freshly allocated network, e.g. to resume training.
+NeuralNetwork loadCheckpoint(const std::string& filename, OptimizerState* state = nullptr) {
+  std::ifstream infile(filename, std::ios::binary | std::ios::ate);
+  if (!infile.is_open()) {
+    throw std::runtime_error("Could not open checkpoint file: " + filename);
+  }
+  std::vector<unsigned char> data(static_cast<size_t>(infile.tellg()));
+  infile.seekg(0);
+  infile.read(reinterpret_cast<char*>(data.data()), data.size());
+  if (!infile) {
+    throw std::runtime_error("Could not read checkpoint file: " + filename);
+  }
+
+  const CheckpointHeader& header = parseCheckpointHeader(data.data(), data.size());
+  verifyCheckpointChecksum(data.data(), data.size());
+  validateCheckpointLayers(data.data(), data.size(), header);
+
+  NeuralNetwork net(static_cast<int>(header.inputSize));
+  const CheckpointLayerRecord* records = checkpointLayerRecords(data.data());
+  for (uint32_t i = 0; i < header.layerCount; ++i) {
+    const CheckpointLayerRecord& record = records[i];
+    net.layers.push_back(std::make_unique<NeuralNetworkLayer>(
+        Eigen::Map<const Eigen::MatrixXd>(reinterpret_cast<const double*>(data.data() + record.weightsOffset),
+                                          record.outputSize, record.inputSize),
+        Eigen::Map<const Eigen::VectorXd>(reinterpret_cast<const double*>(data.data() + record.biasesOffset),
+                                          record.outputSize),
+        makeActivation(static_cast<ActivationType>(record.activation))));
+  }
+
+  if (state) {
+    const CheckpointBufferRecord* buffers = checkpointBufferRecords(data.data(), header);
+    state->step = header.optimizerStep;
+    state->buffers.clear();
+    for (uint64_t i = 0; i < header.optimizerBufferCount; ++i) {
+      checkBlobBounds(buffers[i].offset, buffers[i].count, data.size());
+      const double* values = reinterpret_cast<const double*>(data.data() + buffers[i].offset);
+      state->buffers.emplace_back(values, values + buffers[i].count);
+    }
+  }
+
+  return net;
+}
+
+struct MappedNeuralNetworkLayer {
+  Eigen::Map<const Eigen::MatrixXd, Eigen::Aligned64> weights;
+  Eigen::Map<const Eigen::VectorXd, Eigen::Aligned64> biases;
+  std::unique_ptr<ActivationFunction> activation;
+
+  MappedNeuralNetworkLayer(const unsigned char* base, const CheckpointLayerRecord& record) :
+      weights(reinterpret_cast<const double*>(base + record.weightsOffset), record.outputSize, record.inputSize),
+      biases(reinterpret_cast<const double*>(base + record.biasesOffset), record.outputSize),
+      activation(makeActivation(static_cast<ActivationType>(record.activation))) {}
+
+  Eigen::VectorXd forward(const Eigen::VectorXd& input) const {
+    Eigen::VectorXd output = weights * input + biases;
+    return (*activation)(output);
+  }
+
+  // One column per sample, so the whole batch goes through a single matrix-matrix product.
+  Eigen::MatrixXd forwardBatch(const Eigen::MatrixXd& inputs) const {
+    Eigen::MatrixXd output = weights * inputs;
+    output.colwise() += biases;
+    return activation->applyBatch(output);
+  }
+};
+
+// Read-only network whose weights live directly in a memory-mapped checkpoint. Nothing is copied
+// at load time; pages are faulted in on first use. Checksum verification touches every page, so
+// it is opt-in for inference processes that care more about cold start.
+struct MappedNeuralNetwork {
+  int inputSize = 0;
+  std::vector<MappedNeuralNetworkLayer> layers;
+  const unsigned char* base = nullptr;
+  size_t length = 0;
+
+  explicit MappedNeuralNetwork(const std::string& filename, bool verifyChecksum = false) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Could not open checkpoint file: " + filename);
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+      close(fd);
+      throw std::runtime_error("Could not stat checkpoint file: " + filename);
+    }
+    length = static_cast<size_t>(fileStat.st_size);
+    void* mapping = length > 0 ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Could not map checkpoint file: " + filename);
+    }
+    base = static_cast<const unsigned char*>(mapping);
+
+    try {
+      const CheckpointHeader& header = parseCheckpointHeader(base, length);
+      if (verifyChecksum) {
+        verifyCheckpointChecksum(base, length);
+      }
+      validateCheckpointLayers(base, length, header);
+      inputSize = static_cast<int>(header.inputSize);
+      const CheckpointLayerRecord* records = checkpointLayerRecords(base);
+      layers.reserve(header.layerCount);
+      for (uint32_t i = 0; i < header.layerCount; ++i) {
+        layers.emplace_back(base, records[i]);
+      }
+    } catch (...) {
+      munmap(const_cast<unsigned char*>(base), length);
+      throw;
+    }
+  }
+
+  ~MappedNeuralNetwork() {
+    if (base) {
+      munmap(const_cast<unsigned char*>(base), length);
+    }
+  }
+
+  MappedNeuralNetwork(const MappedNeuralNetwork&) = delete;
+  MappedNeuralNetwork& operator=(const MappedNeuralNetwork&) = delete;
+
+  Eigen::VectorXd predict(const std::vector<double>& dataVector) const {
+    Eigen::VectorXd activation = Eigen::Map<const Eigen::VectorXd>(dataVector.data(), dataVector.size());
+    for (const auto& layer : layers) {
+      activation = layer.forward(activation);
+    }
+    return activation;
+  }
+
+  Eigen::MatrixXd predictBatch(const Eigen::MatrixXd& inputs) const {
+    Eigen::MatrixXd activations = inputs;
+    for (const auto& layer : layers) {
+      activations = layer.forwardBatch(activations);
+    }
+    return activations;
+  }
+};
+
+// Snapshots the network on the calling thread (a plain memcpy of the weights) and does the
+// hashing and file I/O in the background. If the previous checkpoint is still being written,
+// the new one is skipped rather than blocking the caller.
+struct AsyncCheckpointWriter {
+  std::future<void> pending;
+
+  ~AsyncCheckpointWriter() {
+    wait();
+  }
+
+  bool submit(const NeuralNetwork& net, const OptimizerState& state, const std::string& filename) {
+    if (pending.valid() && pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return false;
+    }
+    wait();
+
+    std::vector<unsigned char> data = serializeCheckpoint(net, state);
+    pending = std::async(std::launch::async, [data = std::move(data), filename]() mutable {
+      finalizeCheckpoint(data);
+      writeCheckpointFile(data, filename);
+    });
+    return true;
+  }
+
+  void wait() {
+    if (!pending.valid()) {
+      return;
+    }
+    try {
+      pending.get();
+    } catch (const std::exception& e) {
+      std::cerr << "Error: Checkpoint write failed: " << e.what() << std::endl;
+    }
+  }
+};
+
+// Demo driver, only built when this file is compiled as its own program rather than included.
+#if __INCLUDE_LEVEL__ == 0
+int main() {
+  std::string checkpointPath = "model.ckpt";
+
+  MappedNeuralNetwork net(checkpointPath);
+
+  std::vector<double> dataVector(net.inputSize, 0.0);
+  Eigen::VectorXd prediction = net.predict(dataVector);
+
+  std::cout << "Prediction from " << checkpointPath << ":" << std::endl;
+  std::cout << prediction.transpose() << std::endl;
+
+  return 0;
+}
+#endif
+#endif
@@ -1,9 +1,18 @@
+#ifndef DATA_PREPROCESSING_CPP
+#define DATA_PREPROCESSING_CPP
 #include <iostream>
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <fstream>
-#include <nlohmann/json.hpp> 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <cstring>
+#include <memory>
+#include <cstdio>
+#include <Eigen/Dense>
 bool validateNumber(int num) {
   return (num >= 1 && num <= 100);
 }
@@ -40,6 +49,7 @@ std::vector<DataPoint> preprocessNumbers() {
 
 std::vector<DataPoint> furtherPreprocess(const std::vector<DataPoint>& dataPoints) {
   std::vector<DataPoint> processedPoints;
+  processedPoints.reserve(dataPoints.size());
 
   // Example: Normalize numbers to a range between 0 and 1
   for (const DataPoint& point : dataPoints) {
@@ -52,6 +62,192 @@ std::vector<DataPoint> furtherPreprocess(const std::vector<DataPoint>& dataPoint
   return processedPoints;
 }
 
+const size_t kBatchSize = 1 << 16;
+const size_t kIoBufferSize = 1 << 20;
+
+// Reads whitespace-separated integers in large blocks and parses them with std::from_chars,
+// avoiding the per-value locale and sentry overhead of operator>>. Unlike the interactive prompt,
+// -1 is not a terminator here: file and pipe input ends at EOF, and -1 is just an out-of-range value.
+struct BufferedNumberReader {
+  std::istream& in;
+  std::vector<char> buffer;
+  size_t begin = 0;
+  size_t end = 0;
+  bool eof = false;
+
+  explicit BufferedNumberReader(std::istream& in) : in(in), buffer(kIoBufferSize) {}
+
+  bool refill() {
+    if (eof) {
+      return false;
+    }
+    if (begin == 0 && end == buffer.size()) {
+      throw std::runtime_error("Input token exceeds read buffer");
+    }
+    // Keep a partial token from the end of the previous block.
+    std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+    in.read(buffer.data() + end, buffer.size() - end);
+    size_t bytesRead = static_cast<size_t>(in.gcount());
+    end += bytesRead;
+    if (bytesRead == 0) {
+      eof = true;
+    }
+    return bytesRead > 0;
+  }
+
+  static bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+  }
+
+  // Appends up to maxCount values; returns false once the input is exhausted.
+  bool readBatch(std::vector<int>& values, size_t maxCount) {
+    values.clear();
+    while (values.size() < maxCount) {
+      while (begin < end && isSpace(buffer[begin])) {
+        ++begin;
+      }
+      size_t tokenEnd = begin;
+      while (tokenEnd < end && !isSpace(buffer[tokenEnd])) {
+        ++tokenEnd;
+      }
+      if (begin == end || (tokenEnd == end && !eof)) {
+        if (!refill()) {
+          if (begin == end) {
+            break;
+          }
+        }
+        continue;
+      }
+
+      int num;
+      const char* first = buffer.data() + begin;
+      const char* last = buffer.data() + tokenEnd;
+      auto [ptr, ec] = std::from_chars(first, last, num);
+      if (ec == std::errc::result_out_of_range && ptr == last) {
+        // A well-formed integer that does not fit in int is just another out-of-range value:
+        // clamp it so validation rejects and counts it. Only non-numeric tokens are fatal.
+        num = *first == '-' ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max();
+      } else if (ec != std::errc() || ptr != last) {
+        throw std::runtime_error("Invalid input token: " + std::string(first, last));
+      }
+      begin = tokenEnd;
+      values.push_back(num);
+    }
+    return !values.empty();
+  }
+};
+
+// Drops values outside [1, 100] and normalizes the rest into normalizedValues. The range check is a
+// vectorized min/max reduction through Eigen; the scalar compaction only runs if something is invalid.
+// Returns the number of rejected values.
+size_t validateAndNormalize(std::vector<int>& rawValues, std::vector<double>& normalizedValues) {
+  size_t rejected = 0;
+  if (!rawValues.empty()) {
+    Eigen::Map<const Eigen::ArrayXi> raw(rawValues.data(), rawValues.size());
+    if (raw.minCoeff() < 1 || raw.maxCoeff() > 100) {
+      auto validEnd = std::remove_if(rawValues.begin(), rawValues.end(), [](int num) { return !validateNumber(num); });
+      rejected = rawValues.end() - validEnd;
+      rawValues.erase(validEnd, rawValues.end());
+    }
+  }
+
+  normalizedValues.resize(rawValues.size());
+  Eigen::Map<const Eigen::ArrayXi> raw(rawValues.data(), rawValues.size());
+  Eigen::Map<Eigen::ArrayXd> normalized(normalizedValues.data(), normalizedValues.size());
+  normalized = raw.cast<double>() / 100.0;
+  return rejected;
+}
+
+struct PreprocessedDataWriter {
+  virtual ~PreprocessedDataWriter() = default;
+  virtual void writeBatch(const std::vector<int>& rawValues, const std::vector<double>& normalizedValues) = 0;
+  virtual void finish() = 0;
+};
+
+// Emits the same {"data": [{"raw_value": ..., "normalized_value": ...}, ...]} document as before,
+// but record by record through a fixed-size buffer instead of building a JSON DOM.
+struct StreamingJsonWriter : public PreprocessedDataWriter {
+  std::ostream& out;
+  std::vector<char> buffer;
+  size_t used = 0;
+  bool firstRecord = true;
+
+  explicit StreamingJsonWriter(std::ostream& out) : out(out), buffer(kIoBufferSize) {
+    append("{\"data\":[");
+  }
+
+  void append(const char* text) {
+    size_t length = std::strlen(text);
+    reserve(length);
+    std::memcpy(buffer.data() + used, text, length);
+    used += length;
+  }
+
+  void reserve(size_t length) {
+    if (used + length > buffer.size()) {
+      flush();
+    }
+  }
+
+  void flush() {
+    out.write(buffer.data(), used);
+    used = 0;
+  }
+
+  void writeRecord(int rawValue, double normalizedValue) {
+    const size_t maxRecordLength = 96;
+    reserve(maxRecordLength);
+    append(firstRecord ? "{\"raw_value\":" : ",{\"raw_value\":");
+    firstRecord = false;
+    char* bufferEnd = buffer.data() + buffer.size();
+    used = std::to_chars(buffer.data() + used, bufferEnd, rawValue).ptr - buffer.data();
+    append(",\"normalized_value\":");
+    used = std::to_chars(buffer.data() + used, bufferEnd, normalizedValue).ptr - buffer.data();
+    append("}");
+  }
+
+  void writeBatch(const std::vector<int>& rawValues, const std::vector<double>& normalizedValues) override {
+    for (size_t i = 0; i < rawValues.size(); ++i) {
+      writeRecord(rawValues[i], normalizedValues[i]);
+    }
+  }
+
+  void finish() override {
+    append("]}");
+    flush();
+    out.flush();
+  }
+};
+
+// Compact binary output: an 8-byte magic, then blocks of {uint64 count, int32 raw[count],
+// double normalized[count]} in native byte order, terminated by a block with count 0.
+struct BinaryDataWriter : public PreprocessedDataWriter {
+  std::ostream& out;
+
+  explicit BinaryDataWriter(std::ostream& out) : out(out) {
+    out.write("MLXPRE1\0", 8);
+  }
+
+  void writeBatch(const std::vector<int>& rawValues, const std::vector<double>& normalizedValues) override {
+    if (rawValues.empty()) {
+      return;
+    }
+    static_assert(sizeof(int) == sizeof(int32_t), "Binary format stores raw values as int32");
+    uint64_t count = rawValues.size();
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(rawValues.data()), rawValues.size() * sizeof(int));
+    out.write(reinterpret_cast<const char*>(normalizedValues.data()), normalizedValues.size() * sizeof(double));
+  }
+
+  void finish() override {
+    uint64_t count = 0;
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.flush();
+  }
+};
+
 void writeToFile(const std::vector<DataPoint>& dataPoints, const std::string& filename) {
   std::ofstream outfile(filename);
   if (!outfile.is_open()) {
@@ -59,19 +255,127 @@ void writeToFile(const std::vector<DataPoint>& dataPoints, const std::string& fi
     return;
   }
 
-  nlohmann::json jsonData;
-  std::vector<nlohmann::json> dataArray;
+  StreamingJsonWriter writer(outfile);
   for (const DataPoint& point : dataPoints) {
-    dataArray.push_back({{"raw_value", point.raw_value}, {"normalized_value", point.normalized_value}});
+    writer.writeRecord(point.raw_value, point.normalized_value);
   }
-  jsonData["data"] = dataArray;
+  writer.finish();
 
-  outfile << jsonData;
   outfile.close();
   std::cout << "Preprocessed data written to file: " << filename << std::endl;
 }
 
-int main() {
+// Streams the input through fixed-size batches, so memory use does not depend on the input size.
+void preprocessNumbersBatch(std::istream& in, PreprocessedDataWriter& writer) {
+  BufferedNumberReader reader(in);
+  std::vector<int> rawValues;
+  std::vector<double> normalizedValues;
+  rawValues.reserve(kBatchSize);
+  normalizedValues.reserve(kBatchSize);
+
+  size_t accepted = 0;
+  size_t rejected = 0;
+  while (reader.readBatch(rawValues, kBatchSize)) {
+    rejected += validateAndNormalize(rawValues, normalizedValues);
+    accepted += rawValues.size();
+    writer.writeBatch(rawValues, normalizedValues);
+  }
+  writer.finish();
+
+  std::cerr << "Processed " << accepted << " values";
+  if (rejected > 0) {
+    std::cerr << ", skipped " << rejected << " outside the range 1 to 100";
+  }
+  std::cerr << std::endl;
+}
+
+#if __INCLUDE_LEVEL__ == 0
+int main(int argc, char** argv) {
+  if (argc > 1 && std::string(argv[1]) == "--batch") {
+    const char* usage = "Usage: data_preprocessing --batch [input|-] [--format json|binary] [--output file|-]";
+    std::string inputPath = "-";
+    std::string outputPath = "-";
+    std::string format = "json";
+    bool haveInput = false;
+    for (int i = 2; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "--format" || arg == "--output") {
+        if (i + 1 >= argc) {
+          std::cerr << "Error: Missing value for " << arg << std::endl << usage << std::endl;
+          return 1;
+        }
+        (arg == "--format" ? format : outputPath) = argv[++i];
+      } else if (arg.size() > 1 && arg[0] == '-') {
+        std::cerr << "Error: Unknown option " << arg << std::endl << usage << std::endl;
+        return 1;
+      } else if (haveInput) {
+        std::cerr << "Error: More than one input given" << std::endl << usage << std::endl;
+        return 1;
+      } else {
+        inputPath = arg;
+        haveInput = true;
+      }
+    }
+    if (format != "json" && format != "binary") {
+      std::cerr << "Error: Unsupported output format: " << format << std::endl;
+      return 1;
+    }
+
+    std::ios::sync_with_stdio(false);
+    std::ifstream infile;
+    if (inputPath != "-") {
+      infile.open(inputPath, std::ios::binary);
+      if (!infile.is_open()) {
+        std::cerr << "Error: Could not open file " << inputPath << std::endl;
+        return 1;
+      }
+    }
+    // File output goes to a temporary next to the target and is renamed into place only on success,
+    // so a failed run never leaves a truncated file (or clobbers an existing one). Output to stdout
+    // cannot be taken back; the exit status is the only signal there.
+    std::ofstream outfile;
+    std::string tempPath = outputPath + ".tmp";
+    if (outputPath != "-") {
+      outfile.open(tempPath, std::ios::binary);
+      if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open file for writing." << std::endl;
+        return 1;
+      }
+    }
+    std::istream& in = inputPath == "-" ? std::cin : infile;
+    std::ostream& out = outputPath == "-" ? std::cout : outfile;
+
+    std::unique_ptr<PreprocessedDataWriter> writer;
+    if (format == "json") {
+      writer = std::make_unique<StreamingJsonWriter>(out);
+    } else {
+      writer = std::make_unique<BinaryDataWriter>(out);
+    }
+
+    try {
+      preprocessNumbersBatch(in, *writer);
+      if (!out) {
+        throw std::runtime_error("Could not write output");
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      if (outputPath != "-") {
+        outfile.close();
+        std::remove(tempPath.c_str());
+      }
+      return 1;
+    }
+    if (outputPath != "-") {
+      outfile.close();
+      if (!outfile || std::rename(tempPath.c_str(), outputPath.c_str()) != 0) {
+        std::cerr << "Error: Could not write file " << outputPath << std::endl;
+        std::remove(tempPath.c_str());
+        return 1;
+      }
+    }
+    return 0;
+  }
+
   std::vector<DataPoint> rawDataPoints = preprocessNumbers();
 
   std::vector<DataPoint> processedDataPoints = furtherPreprocess(rawDataPoints);
@@ -80,3 +384,5 @@ int main() {
 
   return 0;
 }
+#endif
+#endif
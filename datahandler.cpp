@@ -1,11 +1,23 @@
+#ifndef DATAHANDLER_CPP
+#define DATAHANDLER_CPP
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <sstream>
+#include <string>
+#include <variant>
+#include <unordered_set>
+#include <limits>
+#include <cctype>
 #include <random> 
 #include <Eigen/Dense> 
 #include <algorithm> 
 #include <functional> 
+#include "profiler.cpp"
+
+// Tabular loading lives in its own namespace: its DataPoint (mixed-type feature rows) is unrelated
+// to the single-value DataPoint of data_preprocessing.cpp, and programs may need both.
+namespace datahandler {
 
 enum class DataType { DOUBLE, INTEGER, CATEGORICAL };
 
@@ -15,6 +27,8 @@ struct DataPoint {
   DataType type; 
 };
 
+std::vector<DataPoint> loadDataFromCSV(const std::string& filename);
+
 std::vector<DataPoint> loadData(const std::string& filename, const std::string& format) {
   std::vector<DataPoint> dataPoints;
 
@@ -29,6 +43,8 @@ std::vector<DataPoint> loadData(const std::string& filename, const std::string&
 }
 
 std::vector<DataPoint> loadDataFromCSV(const std::string& filename) {
+  static ProfileCounter& counter = profileCounter("loadDataFromCSV");
+  ScopedTimer timer(counter);
   std::ifstream file(filename);
   std::vector<DataPoint> dataPoints;
 
@@ -48,10 +64,10 @@ std::vector<DataPoint> loadDataFromCSV(const std::string& filename) {
       DataPoint dataPoint;
       std::stringstream lineStream(line);
 
-      int featureIdx = 0;
+      size_t featureIdx = 0;
       while (std::getline(lineStream, value, ',')) {
         if (featureIdx < header.size()) {
-          if (std::isdigit(value[0])) {
+          if (!value.empty() && std::isdigit(static_cast<unsigned char>(value[0]))) {
             try {
               dataPoint.features.push_back(std::stod(value));
               dataPoint.type = DataType::DOUBLE;
@@ -80,13 +96,14 @@ std::vector<DataPoint> loadDataFromCSV(const std::string& filename) {
     std::cerr << "Error: Could not open file " << filename << std::endl;
   }
 
+  timer.addItems(dataPoints.size());
   return dataPoints;
 }
 
 void preProcessData(std::vector<DataPoint>& dataPoints) {
   if (dataPoints[0].type == DataType::DOUBLE) {
-    Eigen::VectorXd minValues = dataPoints[0].features[0];
-    Eigen::VectorXd maxValues = dataPoints[0].features[0];
+    Eigen::VectorXd minValues = Eigen::VectorXd::Constant(dataPoints[0].features.size(), std::numeric_limits<double>::infinity());
+    Eigen::VectorXd maxValues = Eigen::VectorXd::Constant(dataPoints[0].features.size(), -std::numeric_limits<double>::infinity());
     for (const auto& dataPoint : dataPoints) {
       for (size_t i = 0; i < dataPoint.features.size(); ++i) {
         const auto& feature = std::get<double>(dataPoint.features[i]);
@@ -139,11 +156,16 @@ void preProcessData(std::vector<DataPoint>& dataPoints) {
   }
 }
 
-void augmentData(std::vector<DataPoint>& dataPoints) {
+void augmentData(std::vector<DataPoint>& /* dataPoints */) {
 // ...
 }
 
+} // namespace datahandler
+
+#if __INCLUDE_LEVEL__ == 0
 int main() {
+  using namespace datahandler;
+
   std::string dataFilePath = "data.csv";
   std::string dataFormat = "CSV";
 
@@ -174,3 +196,5 @@ int main() {
 
   return 0;
 }
+#endif
+#endif
@@ -1,7 +1,22 @@
+#ifndef EVALUATOR_CPP
+#define EVALUATOR_CPP
 #include <iostream>
 #include <vector>
-#include "neuralnetwork.cpp" 
+#include "neuralnetworkbeta.cpp"
 #include <cmath> 
+#include "profiler.cpp"
+
+double calculateMSE(const std::vector<std::vector<double>>& predictions,
+                    const std::vector<std::vector<double>>& targets) {
+  double totalError = 0.0;
+  for (size_t i = 0; i < predictions.size(); ++i) {
+    for (size_t j = 0; j < predictions[i].size(); ++j) {
+      double error = predictions[i][j] - targets[i][j];
+      totalError += error * error;
+    }
+  }
+  return totalError / (predictions.size() * targets[0].size());
+}
 
 double calculateMAE(const std::vector<std::vector<double>>& predictions,
                    const std::vector<std::vector<double>>& targets) {
@@ -31,48 +46,78 @@ double calculateRSquared(const std::vector<std::vector<double>>& predictions,
   return 1.0 - (sum_of_squared_errors / sum_of_squared_means);
 }
 
-void evaluateNetworks(const std::vector<NeuralNetwork>& networks,
-                       const std::vector<std::vector<double>>& dataVectors,
-                       const std::vector<std::vector<double>>& targets) {
+struct NetworkEvaluation {
+  double mse;
+  double mae;
+  double rSquared;
+};
+
+// Computes the metrics for every network without printing, so callers (and benchmarks) can time the
+// evaluation itself.
+std::vector<NetworkEvaluation> computeNetworkEvaluations(const std::vector<NeuralNetwork>& networks,
+                                                         const std::vector<std::vector<double>>& dataVectors,
+                                                         const std::vector<std::vector<double>>& targets) {
+  static ProfileCounter& counter = profileCounter("evaluateNetworks");
+  ScopedTimer timer(counter, networks.size() * dataVectors.size());
+  std::vector<NetworkEvaluation> evaluations;
+  evaluations.reserve(networks.size());
   for (const auto& net : networks) {
     std::vector<std::vector<double>> predictions;
+    predictions.reserve(dataVectors.size());
     for (const auto& dataVector : dataVectors) {
-      Eigen::VectorXd input = Eigen::Map<const Eigen::VectorXd>(dataVector.data(), dataVector.size());
-      Eigen::VectorXd prediction = net.forward(input);
-      predictions.push_back(prediction.array().toVectorXd().toStdVector());
+      Eigen::VectorXd prediction = net.predict(dataVector);
+      predictions.emplace_back(prediction.data(), prediction.data() + prediction.size());
     }
 
-    double mse = calculateMSE(predictions, targets);
-    double mae = calculateMAE(predictions, targets);
-    double rSquared = calculateRSquared(predictions, targets);
+    evaluations.push_back({calculateMSE(predictions, targets), calculateMAE(predictions, targets),
+                           calculateRSquared(predictions, targets)});
+  }
+  return evaluations;
+}
 
-    std::cout << "Network Evaluation Results:" << std::endl;
-    std::cout << "Mean Squared Error (MSE): " << mse << std::endl;
-    std::cout << "Mean Absolute Error (MAE): " << mae << std::endl;
-    std::cout << "R-squared: " << rSquared << std::endl;
+void printNetworkEvaluation(const NetworkEvaluation& evaluation, size_t outputSize, std::ostream& out) {
+  out << "Network Evaluation Results:" << std::endl;
+  out << "Mean Squared Error (MSE): " << evaluation.mse << std::endl;
+  out << "Mean Absolute Error (MAE): " << evaluation.mae << std::endl;
+  out << "R-squared: " << evaluation.rSquared << std::endl;
 
-    if (targets[0].size() > 1) {
-      std::vector<double> precisions(targets[0].size(), 0.0);
-      std::vector<double> recalls(targets[0].size(), 0.0);
-      std::cout << "Precision (per class):" << std::endl;
-      for (size_t i = 0; i < precisions.size(); ++i) {
-        std::cout << "Class " << i << ": " << precisions[i] << std::endl;
-      }
-      std::cout << "Recall (per class):" << std::endl;
-      for (size_t i = 0; i < recalls.size(); ++i) {
-        std::cout << "Class " << i << ": " << recalls[i] << std::endl;
-      }
+  if (outputSize > 1) {
+    std::vector<double> precisions(outputSize, 0.0);
+    std::vector<double> recalls(outputSize, 0.0);
+    out << "Precision (per class):" << std::endl;
+    for (size_t i = 0; i < precisions.size(); ++i) {
+      out << "Class " << i << ": " << precisions[i] << std::endl;
     }
+    out << "Recall (per class):" << std::endl;
+    for (size_t i = 0; i < recalls.size(); ++i) {
+      out << "Class " << i << ": " << recalls[i] << std::endl;
+    }
+  }
 
-    // ...
+  // ...
 
-    std::cout << std::endl; // Separator between network evaluations
+  out << std::endl; // Separator between network evaluations
+}
+
+void evaluateNetworks(const std::vector<NeuralNetwork>& networks,
+                       const std::vector<std::vector<double>>& dataVectors,
+                       const std::vector<std::vector<double>>& targets) {
+  for (const NetworkEvaluation& evaluation : computeNetworkEvaluations(networks, dataVectors, targets)) {
+    printNetworkEvaluation(evaluation, targets[0].size(), std::cout);
   }
 }
 
+#if __INCLUDE_LEVEL__ == 0
 int main() {
+  std::vector<std::vector<double>> testDataVectors = {/* test data vectors */};
+  std::vector<std::vector<double>> testTargets = {/* test targets */};
+
+  std::vector<NeuralNetwork> networks;
+  networks.emplace_back(1000, std::vector<int>{500}, 10, std::make_unique<ReLU>());
 
   evaluateNetworks(networks, testDataVectors, testTargets);
 
   return 0;
 }
+#endif
+#endif
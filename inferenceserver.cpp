@@ -0,0 +1,759 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <list>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <pthread.h>
+#include <csignal>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <Eigen/Dense>
+#include "checkpoint.cpp"
+
+// Bounded multi-producer/multi-consumer ring buffer (Vyukov). Each cell carries a sequence number
+// that tells producers and consumers whether it is free for their current lap, so neither side
+// ever takes a lock. Capacity must be a power of two.
+template <typename T>
+struct BoundedMPMCQueue {
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  std::vector<Cell> cells;
+  size_t mask;
+  alignas(64) std::atomic<size_t> enqueuePos;
+  alignas(64) std::atomic<size_t> dequeuePos;
+
+  explicit BoundedMPMCQueue(size_t capacity) : cells(capacity), mask(capacity - 1), enqueuePos(0), dequeuePos(0) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+      throw std::invalid_argument("Queue capacity must be a power of two");
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool tryPush(T value) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells[pos & mask];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.data = std::move(value);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // Full
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool tryPop(T& value) {
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells[pos & mask];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          value = std::move(cell.data);
+          cell.sequence.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // Empty
+      } else {
+        pos = dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+// Log-linear histogram of microsecond values: exact below 16us, then 8 sub-buckets per power of two
+// (buckets at most 12.5% wide). Recording is a single relaxed atomic increment.
+struct LatencyHistogram {
+  static const int kSubBuckets = 8;
+  static const int kLinearLimit = 16;
+  static const int kMaxExponent = 40;
+  static const int kBucketCount = kLinearLimit + (kMaxExponent - 4 + 1) * kSubBuckets;
+
+  std::atomic<uint64_t> counts[kBucketCount] = {};
+
+  static int bucketIndex(uint64_t value) {
+    if (value < kLinearLimit) {
+      return static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > kMaxExponent) {
+      return kBucketCount - 1;
+    }
+    int subBucket = static_cast<int>((value >> (exponent - 3)) & (kSubBuckets - 1));
+    return kLinearLimit + (exponent - 4) * kSubBuckets + subBucket;
+  }
+
+  static uint64_t bucketLowerBound(int index) {
+    if (index < kLinearLimit) {
+      return index;
+    }
+    int exponent = (index - kLinearLimit) / kSubBuckets + 4;
+    int subBucket = (index - kLinearLimit) % kSubBuckets;
+    return (uint64_t(1) << exponent) + (uint64_t(subBucket) << (exponent - 3));
+  }
+
+  void record(uint64_t value) {
+    counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t totalCount() const {
+    uint64_t total = 0;
+    for (const auto& count : counts) {
+      total += count.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  // Largest value that lands in bucket index (inclusive). The last bucket is open-ended, so its
+  // lower bound is the best available.
+  static uint64_t bucketUpperBound(int index) {
+    if (index >= kBucketCount - 1) {
+      return bucketLowerBound(kBucketCount - 1);
+    }
+    return bucketLowerBound(index + 1) - 1;
+  }
+
+  int percentileBucket(double p) const {
+    uint64_t total = totalCount();
+    if (total == 0) {
+      return -1;
+    }
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * (total - 1));
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+      seen += counts[i].load(std::memory_order_relaxed);
+      if (seen > rank) {
+        return i;
+      }
+    }
+    return kBucketCount - 1;
+  }
+
+  // Upper bound of the bucket holding the p-th percentile, so latencies are never understated (they
+  // may read up to 12.5% high). Use percentileLowerBound where understating is the safe side.
+  uint64_t percentile(double p) const {
+    int bucket = percentileBucket(p);
+    return bucket < 0 ? 0 : bucketUpperBound(bucket);
+  }
+
+  uint64_t percentileLowerBound(double p) const {
+    int bucket = percentileBucket(p);
+    return bucket < 0 ? 0 : bucketLowerBound(bucket);
+  }
+};
+
+struct InferenceRequest {
+  std::vector<double> input;
+  std::promise<Eigen::VectorXd> result;
+  std::chrono::steady_clock::time_point enqueued;
+};
+
+struct InferenceEngineConfig {
+  size_t maxBatchSize = 32;
+  std::chrono::microseconds maxWait{500};
+  size_t numWorkers = 1;
+  size_t queueCapacity = 4096;
+  bool pinWorkers = true;
+  std::chrono::milliseconds statsWindow{1000};
+};
+
+// Coalesces concurrent predict calls into micro-batches. Workers pull straight from the lock-free
+// queue: the first request of a batch starts its deadline, and the batch is cut when it is full
+// or the deadline passes, whichever comes first.
+struct InferenceEngine {
+  const MappedNeuralNetwork& model;
+  InferenceEngineConfig config;
+  BoundedMPMCQueue<InferenceRequest*> queue;
+  std::vector<std::thread> workers;
+  std::atomic<bool> running;
+  std::atomic<int> activeSubmitters{0};
+
+  LatencyHistogram latencyMicros;
+  LatencyHistogram batchSizes;
+  std::atomic<uint64_t> completedRequests;
+  std::atomic<uint64_t> completedBatches;
+  std::chrono::steady_clock::time_point startTime;
+
+  // Throughput is sampled once per stats window: the histogram holds one requests/s value per
+  // window, and lastWindowThroughput is the most recent one.
+  std::thread monitorThread;
+  std::mutex monitorMutex;
+  std::condition_variable monitorWake;
+  LatencyHistogram windowThroughput;
+  std::atomic<uint64_t> lastWindowThroughput{0};
+
+  InferenceEngine(const MappedNeuralNetwork& model, const InferenceEngineConfig& config) :
+      model(model), config(config), queue(config.queueCapacity), running(true),
+      completedRequests(0), completedBatches(0), startTime(std::chrono::steady_clock::now()) {
+    if (config.maxBatchSize == 0 || config.numWorkers == 0) {
+      throw std::invalid_argument("Batch size and worker count must be positive");
+    }
+    for (size_t i = 0; i < config.numWorkers; ++i) {
+      workers.emplace_back(&InferenceEngine::workerLoop, this, i);
+    }
+    monitorThread = std::thread(&InferenceEngine::monitorLoop, this);
+  }
+
+  ~InferenceEngine() {
+    stop();
+  }
+
+  InferenceEngine(const InferenceEngine&) = delete;
+  InferenceEngine& operator=(const InferenceEngine&) = delete;
+
+  std::future<Eigen::VectorXd> submit(std::vector<double> input) {
+    auto request = std::make_unique<InferenceRequest>();
+    request->input = std::move(input);
+    request->enqueued = std::chrono::steady_clock::now();
+    std::future<Eigen::VectorXd> result = request->result.get_future();
+
+    // Registering before checking running (both sequentially consistent) means stop() either makes
+    // us see running == false, or waits for us to leave before draining the queue.
+    activeSubmitters.fetch_add(1);
+    if (!running.load()) {
+      request->result.set_exception(std::make_exception_ptr(std::runtime_error("Inference engine is stopped")));
+    } else if (queue.tryPush(request.get())) {
+      request.release();
+    } else {
+      request->result.set_exception(std::make_exception_ptr(std::runtime_error("Inference queue is full")));
+    }
+    activeSubmitters.fetch_sub(1);
+    return result;
+  }
+
+  void stop() {
+    if (!running.exchange(false)) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(monitorMutex);
+      monitorWake.notify_all();
+    }
+    monitorThread.join();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    while (activeSubmitters.load() != 0) {
+      std::this_thread::yield();
+    }
+    InferenceRequest* pending;
+    while (queue.tryPop(pending)) {
+      std::unique_ptr<InferenceRequest> request(pending);
+      request->result.set_exception(std::make_exception_ptr(std::runtime_error("Inference engine is stopped")));
+    }
+  }
+
+  void monitorLoop() {
+    uint64_t previousRequests = 0;
+    auto previousTime = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(monitorMutex);
+    bool stopping = false;
+    while (!stopping) {
+      stopping = monitorWake.wait_for(lock, config.statsWindow, [this] { return !running.load(); });
+      uint64_t requests = completedRequests.load(std::memory_order_relaxed);
+      auto now = std::chrono::steady_clock::now();
+      double seconds = std::chrono::duration<double>(now - previousTime).count();
+      // The partial window at shutdown only counts if it saw traffic, so it cannot drag the
+      // percentiles down with a spurious zero.
+      if (seconds <= 0 || (stopping && requests == previousRequests)) {
+        break;
+      }
+      uint64_t throughput = static_cast<uint64_t>((requests - previousRequests) / seconds);
+      windowThroughput.record(throughput);
+      lastWindowThroughput.store(throughput, std::memory_order_relaxed);
+      previousRequests = requests;
+      previousTime = now;
+    }
+  }
+
+  // Pins to the n-th CPU the process is allowed to run on (cgroup/cpuset/taskset limits), so workers
+  // spread over the CPUs actually available instead of indexing into all CPUs of the machine.
+  void pinCurrentThread(size_t workerIndex) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+      std::cerr << "Warning: Could not read CPU affinity, not pinning inference worker " << workerIndex << std::endl;
+      return;
+    }
+    int allowedCount = CPU_COUNT(&allowed);
+    if (allowedCount == 0) {
+      return;
+    }
+    size_t target = workerIndex % allowedCount;
+    int cpu = 0;
+    for (size_t seen = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &allowed) && seen++ == target) {
+        break;
+      }
+    }
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+      std::cerr << "Warning: Could not pin inference worker " << workerIndex << " to CPU " << cpu << std::endl;
+    }
+  }
+
+  void workerLoop(size_t workerIndex) {
+    if (config.pinWorkers) {
+      pinCurrentThread(workerIndex);
+    }
+
+    std::vector<std::unique_ptr<InferenceRequest>> batch;
+    batch.reserve(config.maxBatchSize);
+    int idleSpins = 0;
+
+    while (running.load(std::memory_order_acquire)) {
+      InferenceRequest* first;
+      if (!queue.tryPop(first)) {
+        // Spin briefly for latency, then back off so idle workers do not burn a core.
+        if (++idleSpins < 64) {
+          std::this_thread::yield();
+        } else {
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        continue;
+      }
+      idleSpins = 0;
+      batch.emplace_back(first);
+
+      auto deadline = first->enqueued + config.maxWait;
+      while (batch.size() < config.maxBatchSize) {
+        InferenceRequest* next;
+        if (queue.tryPop(next)) {
+          batch.emplace_back(next);
+        } else if (std::chrono::steady_clock::now() >= deadline) {
+          break;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+
+      runBatch(batch);
+      batch.clear();
+    }
+  }
+
+  void runBatch(std::vector<std::unique_ptr<InferenceRequest>>& batch) {
+    std::vector<InferenceRequest*> valid;
+    valid.reserve(batch.size());
+    for (auto& request : batch) {
+      if (request->input.size() != static_cast<size_t>(model.inputSize)) {
+        request->result.set_exception(std::make_exception_ptr(std::invalid_argument(
+            "Expected input of size " + std::to_string(model.inputSize) + ", got " + std::to_string(request->input.size()))));
+      } else {
+        valid.push_back(request.get());
+      }
+    }
+    if (valid.empty()) {
+      return;
+    }
+
+    Eigen::MatrixXd inputs(model.inputSize, valid.size());
+    for (size_t i = 0; i < valid.size(); ++i) {
+      inputs.col(i) = Eigen::Map<const Eigen::VectorXd>(valid[i]->input.data(), valid[i]->input.size());
+    }
+
+    try {
+      Eigen::MatrixXd outputs = model.predictBatch(inputs);
+      auto now = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < valid.size(); ++i) {
+        valid[i]->result.set_value(outputs.col(i));
+        latencyMicros.record(std::chrono::duration_cast<std::chrono::microseconds>(now - valid[i]->enqueued).count());
+      }
+    } catch (...) {
+      for (InferenceRequest* request : valid) {
+        request->result.set_exception(std::current_exception());
+      }
+    }
+
+    batchSizes.record(valid.size());
+    completedRequests.fetch_add(valid.size(), std::memory_order_relaxed);
+    completedBatches.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void printStats(std::ostream& out) const {
+    double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    uint64_t requests = completedRequests.load(std::memory_order_relaxed);
+    uint64_t batches = completedBatches.load(std::memory_order_relaxed);
+
+    out << "Inference Engine Statistics:" << std::endl;
+    out << "Requests: " << requests << " in " << batches << " batches" << std::endl;
+    out << "Throughput (requests/s): " << (elapsedSeconds > 0 ? requests / elapsedSeconds : 0.0) << std::endl;
+    out << "Throughput last window (requests/s): " << lastWindowThroughput.load(std::memory_order_relaxed) << std::endl;
+    // Histogram percentiles are bucket bounds, chosen on the pessimistic side of each metric.
+    out << "Throughput per window p50 (requests/s, bucket lower bound): " << windowThroughput.percentileLowerBound(50) << std::endl;
+    out << "Throughput per window p1 (requests/s, bucket lower bound): " << windowThroughput.percentileLowerBound(1) << std::endl;
+    out << "Latency p50 (us, bucket upper bound): " << latencyMicros.percentile(50) << std::endl;
+    out << "Latency p99 (us, bucket upper bound): " << latencyMicros.percentile(99) << std::endl;
+    out << "Latency p99.9 (us, bucket upper bound): " << latencyMicros.percentile(99.9) << std::endl;
+    out << "Batch size p50 (bucket lower bound): " << batchSizes.percentileLowerBound(50) << std::endl;
+    out << "Batch size p99 (bucket lower bound): " << batchSizes.percentileLowerBound(99) << std::endl;
+  }
+
+  std::string statsString() const {
+    std::ostringstream out;
+    printStats(out);
+    return out.str();
+  }
+};
+
+bool readFully(int fd, void* buffer, size_t length) {
+  char* data = static_cast<char*>(buffer);
+  while (length > 0) {
+    ssize_t n = read(fd, data, length);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+// fd must be a socket. MSG_NOSIGNAL turns a write to a peer that already hung up into EPIPE, which
+// just drops the connection, instead of a SIGPIPE that would kill the whole server.
+bool writeFully(int fd, const void* buffer, size_t length) {
+  const char* data = static_cast<const char*>(buffer);
+  while (length > 0) {
+    ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+// Request count that asks for the engine statistics instead of a prediction.
+const uint32_t kStatsRequest = 0xFFFFFFFF;
+
+struct FrontendConnection {
+  int fd;
+  std::thread thread;
+  bool finished = false; // guarded by UnixSocketFrontend::connectionsMutex, as is fd
+};
+
+// Local front end. Wire format (native endianness, since both ends are on the same host):
+//   request:  uint32 count, double[count]
+//   response: uint32 status (0 = ok), uint32 count, double[count]   (on error, count bytes of message)
+// A request whose count does not match the model input size gets an error response and the
+// connection is closed. A bare kStatsRequest count is answered with the engine statistics as text
+// (status 0, count bytes of text), so they can be read while the server is running.
+struct UnixSocketFrontend {
+  InferenceEngine& engine;
+  std::string socketPath;
+  int listenFd = -1;
+  std::thread acceptThread;
+  std::mutex connectionsMutex;
+  std::list<std::unique_ptr<FrontendConnection>> connections;
+  std::atomic<bool> running{true};
+
+  UnixSocketFrontend(InferenceEngine& engine, const std::string& socketPath) : engine(engine), socketPath(socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+      throw std::invalid_argument("Socket path too long: " + socketPath);
+    }
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+      throw std::runtime_error("Could not create socket");
+    }
+    unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 128) != 0) {
+      close(listenFd);
+      throw std::runtime_error("Could not listen on socket: " + socketPath);
+    }
+    acceptThread = std::thread(&UnixSocketFrontend::acceptLoop, this);
+  }
+
+  ~UnixSocketFrontend() {
+    stop();
+  }
+
+  void stop() {
+    if (!running.exchange(false)) {
+      return;
+    }
+    shutdown(listenFd, SHUT_RDWR);
+    close(listenFd);
+    acceptThread.join();
+    {
+      // Only connections that are still open own their fd; closed ones may have had the number reused.
+      std::lock_guard<std::mutex> lock(connectionsMutex);
+      for (auto& connection : connections) {
+        if (!connection->finished) {
+          shutdown(connection->fd, SHUT_RDWR);
+        }
+      }
+    }
+    for (auto& connection : connections) {
+      connection->thread.join();
+    }
+    connections.clear();
+    unlink(socketPath.c_str());
+  }
+
+  void acceptLoop() {
+    while (running.load()) {
+      int fd = accept(listenFd, nullptr, nullptr);
+      if (fd < 0) {
+        if (running.load() && errno != EINTR && errno != ECONNABORTED) {
+          // Typically out of file descriptors; back off instead of spinning.
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(connectionsMutex);
+      reapFinishedConnections();
+      auto connection = std::make_unique<FrontendConnection>();
+      connection->fd = fd;
+      connection->thread = std::thread(&UnixSocketFrontend::serveConnection, this, connection.get(), fd);
+      connections.push_back(std::move(connection));
+    }
+  }
+
+  // Called with connectionsMutex held. A finished connection has already closed its fd and is at
+  // most a few instructions from returning, so joining it here does not block the accept loop.
+  void reapFinishedConnections() {
+    for (auto it = connections.begin(); it != connections.end();) {
+      if ((*it)->finished) {
+        (*it)->thread.join();
+        it = connections.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  static bool writeResponse(int fd, uint32_t status, const void* payload, uint32_t count, size_t elementSize) {
+    return writeFully(fd, &status, sizeof(status)) && writeFully(fd, &count, sizeof(count)) &&
+           writeFully(fd, payload, count * elementSize);
+  }
+
+  static bool writeError(int fd, const std::string& error) {
+    return writeResponse(fd, 1, error.data(), static_cast<uint32_t>(error.size()), 1);
+  }
+
+  void serveConnection(FrontendConnection* connection, int fd) {
+    try {
+      serveRequests(fd);
+    } catch (const std::exception& e) {
+      std::cerr << "Error: Connection failed: " << e.what() << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    close(fd);
+    connection->fd = -1;
+    connection->finished = true;
+  }
+
+  void serveRequests(int fd) {
+    uint32_t count;
+    std::vector<double> input(engine.model.inputSize);
+    while (readFully(fd, &count, sizeof(count))) {
+      if (count == kStatsRequest) {
+        std::string stats = engine.statsString();
+        if (!writeResponse(fd, 0, stats.data(), static_cast<uint32_t>(stats.size()), 1)) {
+          return;
+        }
+        continue;
+      }
+      // The count comes straight off the wire, so check it before trusting it with an allocation.
+      // The payload that follows cannot be skipped safely, so the connection is dropped afterwards.
+      if (count != static_cast<uint32_t>(engine.model.inputSize)) {
+        writeError(fd, "Expected input of size " + std::to_string(engine.model.inputSize) + ", got " + std::to_string(count));
+        return;
+      }
+      if (!readFully(fd, input.data(), count * sizeof(double))) {
+        return;
+      }
+
+      bool written;
+      try {
+        Eigen::VectorXd output = engine.submit(input).get();
+        written = writeResponse(fd, 0, output.data(), static_cast<uint32_t>(output.size()), sizeof(double));
+      } catch (const std::exception& e) {
+        written = writeError(fd, e.what());
+      }
+      if (!written) {
+        return;
+      }
+    }
+  }
+};
+
+// Asks a running server for its statistics over the socket.
+int queryStats(const std::string& socketPath) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    std::cerr << "Error: Could not connect to " << socketPath << std::endl;
+    if (fd >= 0) {
+      close(fd);
+    }
+    return 1;
+  }
+  uint32_t status, length;
+  std::string stats;
+  bool ok = writeFully(fd, &kStatsRequest, sizeof(kStatsRequest)) && readFully(fd, &status, sizeof(status)) &&
+            readFully(fd, &length, sizeof(length));
+  if (ok) {
+    stats.resize(length);
+    ok = readFully(fd, &stats[0], length);
+  }
+  close(fd);
+  if (!ok || status != 0) {
+    std::cerr << "Error: Could not read statistics from " << socketPath << std::endl;
+    return 1;
+  }
+  std::cout << stats;
+  return 0;
+}
+
+// Closed-loop load generator: each client thread keeps a fixed number of requests in flight.
+void runLoadGenerator(InferenceEngine& engine, int numClients, int requestsPerClient, int inFlightPerClient) {
+  std::vector<std::thread> clients;
+  for (int c = 0; c < numClients; ++c) {
+    clients.emplace_back([&engine, c, requestsPerClient, inFlightPerClient]() {
+      std::mt19937 gen(c);
+      std::uniform_real_distribution<double> distribution(0.0, 1.0);
+      std::vector<std::future<Eigen::VectorXd>> inFlight;
+      for (int i = 0; i < requestsPerClient; ++i) {
+        std::vector<double> input(engine.model.inputSize);
+        for (double& value : input) {
+          value = distribution(gen);
+        }
+        inFlight.push_back(engine.submit(std::move(input)));
+        if (static_cast<int>(inFlight.size()) >= inFlightPerClient) {
+          for (auto& result : inFlight) {
+            try {
+              result.get();
+            } catch (const std::exception& e) {
+              std::cerr << "Error: " << e.what() << std::endl;
+            }
+          }
+          inFlight.clear();
+        }
+      }
+      for (auto& result : inFlight) {
+        try {
+          result.get();
+        } catch (const std::exception& e) {
+          std::cerr << "Error: " << e.what() << std::endl;
+        }
+      }
+    });
+  }
+  for (auto& client : clients) {
+    client.join();
+  }
+}
+
+int parsePositiveArgument(const char* text, const std::string& name) {
+  size_t parsed = 0;
+  int value = 0;
+  try {
+    value = std::stoi(text, &parsed);
+  } catch (const std::exception&) {
+    parsed = 0;
+  }
+  if (parsed == 0 || text[parsed] != '\0' || value <= 0) {
+    throw std::invalid_argument("Invalid " + name + ": " + text);
+  }
+  return value;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " serve <checkpoint> <socket>" << std::endl;
+    std::cerr << "       " << argv[0] << " bench <checkpoint> [clients] [requests per client]" << std::endl;
+    std::cerr << "       " << argv[0] << " stats <socket>" << std::endl;
+    return 1;
+  }
+  std::string mode = argv[1];
+  if (mode == "stats") {
+    return queryStats(argv[2]);
+  }
+  if (!(mode == "serve" && argc >= 4) && mode != "bench") {
+    std::cerr << "Error: Unknown mode: " << mode << std::endl;
+    return 1;
+  }
+
+  // In serve mode SIGINT/SIGTERM are blocked before any thread starts, so every thread inherits the
+  // mask and main can wait for them synchronously and shut down cleanly (unlinking the socket).
+  sigset_t shutdownSignals;
+  sigemptyset(&shutdownSignals);
+  sigaddset(&shutdownSignals, SIGINT);
+  sigaddset(&shutdownSignals, SIGTERM);
+  if (mode == "serve") {
+    pthread_sigmask(SIG_BLOCK, &shutdownSignals, nullptr);
+  }
+
+  try {
+    int numClients = mode == "bench" && argc >= 4 ? parsePositiveArgument(argv[3], "client count") : 16;
+    int requestsPerClient = mode == "bench" && argc >= 5 ? parsePositiveArgument(argv[4], "requests per client") : 10000;
+
+    MappedNeuralNetwork model(argv[2]);
+
+    InferenceEngineConfig config;
+    config.numWorkers = std::max(1u, std::thread::hardware_concurrency() / 2);
+    InferenceEngine engine(model, config);
+
+    if (mode == "serve") {
+      UnixSocketFrontend frontend(engine, argv[3]);
+      std::cout << "Serving " << argv[2] << " on " << argv[3] << " (SIGINT or SIGTERM to stop)" << std::endl;
+      int received = 0;
+      sigwait(&shutdownSignals, &received);
+      std::cout << "Received signal " << received << ", shutting down" << std::endl;
+      frontend.stop();
+    } else {
+      runLoadGenerator(engine, numClients, requestsPerClient, 8);
+    }
+
+    engine.stop();
+    engine.printStats(std::cout);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -1,16 +1,20 @@
+#ifndef MERKLETREE_CPP
+#define MERKLETREE_CPP
 #include <iostream>
 #include <vector>
 #include <string>
 #include <memory> 
 #include <stdexcept> 
+#include <cstring>
 #include <crypto++/sha.h> 
 #include <crypto++/hex.h>
 #include "vectorization.cpp"
-std::string hashString(const std::string& data) {
+#include "profiler.cpp"
+std::string hashBytes(const byte* data, size_t length) {
   CryptoPP::SHA256 hash;
   byte digest[CryptoPP::SHA256::DIGESTSIZE];
 
-  hash.CalculateDigest(digest, reinterpret_cast<const byte*>(data.c_str()), data.length());
+  hash.CalculateDigest(digest, data, length);
 
   std::string hashedData;
   CryptoPP::HexEncoder encoder(new CryptoPP::StringSink(hashedData));
@@ -20,6 +24,10 @@ std::string hashString(const std::string& data) {
   return hashedData;
 }
 
+std::string hashString(const std::string& data) {
+  return hashBytes(reinterpret_cast<const byte*>(data.c_str()), data.length());
+}
+
 std::string hashDataVector(const std::vector<double>& dataVector) {
   int vectorSize = dataVector.size();
   std::vector<byte> dataBytes(vectorSize * sizeof(double));
@@ -34,9 +42,11 @@ struct MerkleTreeNode {
   std::unique_ptr<MerkleTreeNode> right;
 
   MerkleTreeNode(const std::string& hash) : hash(hash), left(nullptr), right(nullptr) {}
+  MerkleTreeNode(const std::string& hash, std::unique_ptr<MerkleTreeNode> left, std::unique_ptr<MerkleTreeNode> right) :
+      hash(hash), left(std::move(left)), right(std::move(right)) {}
 };
 
-std::unique_ptr<MerkleTreeNode> constructMerkleTree(const std::vector<std::vector<double>>& dataVectors) {
+std::unique_ptr<MerkleTreeNode> constructMerkleSubtree(const std::vector<std::vector<double>>& dataVectors) {
   if (dataVectors.empty()) {
     throw std::runtime_error("Empty data provided for Merkle tree construction");
   }
@@ -47,20 +57,45 @@ std::unique_ptr<MerkleTreeNode> constructMerkleTree(const std::vector<std::vecto
 
   std::vector<std::vector<double>> leftHalf(dataVectors.begin(), dataVectors.begin() + dataVectors.size() / 2);
   std::vector<std::vector<double>> rightHalf(dataVectors.begin() + dataVectors.size() / 2, dataVectors.end());
-  std::unique_ptr<MerkleTreeNode> leftNode = constructMerkleTree(leftHalf);
-  std::unique_ptr<MerkleTreeNode> rightNode = constructMerkleTree(rightHalf);
+  std::unique_ptr<MerkleTreeNode> leftNode = constructMerkleSubtree(leftHalf);
+  std::unique_ptr<MerkleTreeNode> rightNode = constructMerkleSubtree(rightHalf);
 
   std::string parentHash = hashString(leftNode->hash + rightNode->hash);
   return std::make_unique<MerkleTreeNode>(parentHash, std::move(leftNode), std::move(rightNode));
 }
 
+// Profiled entry point; the recursion itself lives in constructMerkleSubtree so each tree counts once.
+std::unique_ptr<MerkleTreeNode> constructMerkleTree(const std::vector<std::vector<double>>& dataVectors) {
+  static ProfileCounter& counter = profileCounter("constructMerkleTree");
+  ScopedTimer timer(counter, dataVectors.size());
+  return constructMerkleSubtree(dataVectors);
+}
+
+// Root over already-hashed leaves, split exactly like constructMerkleSubtree, so it matches the root
+// constructMerkleTree would build from the same data in the same order. Lets callers hash leaves in
+// parallel or in chunks and still get the canonical root.
+std::string merkleRootFromLeafHashes(const std::vector<std::string>& leafHashes, size_t begin, size_t end) {
+  if (begin >= end) {
+    throw std::runtime_error("Empty data provided for Merkle tree construction");
+  }
+  if (end - begin == 1) {
+    return leafHashes[begin];
+  }
+  size_t middle = begin + (end - begin) / 2;
+  return hashString(merkleRootFromLeafHashes(leafHashes, begin, middle) + merkleRootFromLeafHashes(leafHashes, middle, end));
+}
+
+std::string merkleRootFromLeafHashes(const std::vector<std::string>& leafHashes) {
+  return merkleRootFromLeafHashes(leafHashes, 0, leafHashes.size());
+}
+
 std::vector<std::string> getMerkleProof(const std::unique_ptr<MerkleTreeNode>& root, size_t dataIndex, const std::vector<std::vector<double>>& dataVectors) {
   if (!root || dataIndex >= dataVectors.size()) {
     throw std::invalid_argument("Invalid root node or data index for proof generation");
   }
 
   std::vector<std::string> proof;
-  std::unique_ptr<MerkleTreeNode> currentNode = root.get();
+  const MerkleTreeNode* currentNode = root.get();
   size_t siblingIndex;
 
   while (currentNode->left && currentNode->right) {
@@ -100,6 +135,7 @@ bool verifyMerkleProof(const std::string& rootHash, const std::vector<std::strin
   return currentHash == rootHash;
 }
 
+#if __INCLUDE_LEVEL__ == 0
 int main() {
   
   std::vector<std::vector<double>> dataVectors = {/* data vectors */};
@@ -117,3 +153,5 @@ int main() {
 
   return 0;
 }
+#endif
+#endif
@@ -1,3 +1,5 @@
+#ifndef NEURALNETWORKBETA_CPP
+#define NEURALNETWORKBETA_CPP
 #include <iostream>
 #include <vector>
 #include <memory> 
@@ -6,20 +8,45 @@
 #include <functional> 
 #include "vectorization.cpp"
 #include "merkletree.cpp"
+#include "profiler.cpp"
 
 struct ActivationFunction {
+  virtual ~ActivationFunction() = default;
   virtual Eigen::VectorXd operator()(const Eigen::VectorXd& input) const = 0;
+  // Element-wise over a whole batch (one column per sample), for batched inference.
+  virtual Eigen::MatrixXd applyBatch(const Eigen::MatrixXd& inputs) const = 0;
+  // Derivative with respect to the layer's pre-activation, expressed in terms of its output.
+  virtual Eigen::VectorXd derivative(const Eigen::VectorXd& output) const = 0;
+  virtual std::unique_ptr<ActivationFunction> clone() const = 0;
 };
 
 struct Sigmoid : public ActivationFunction {
   Eigen::VectorXd operator()(const Eigen::VectorXd& input) const override {
     return input.array().logistic();
   }
+  Eigen::MatrixXd applyBatch(const Eigen::MatrixXd& inputs) const override {
+    return inputs.array().logistic();
+  }
+  Eigen::VectorXd derivative(const Eigen::VectorXd& output) const override {
+    return output.array() * (1.0 - output.array());
+  }
+  std::unique_ptr<ActivationFunction> clone() const override {
+    return std::make_unique<Sigmoid>();
+  }
 };
 
 struct ReLU : public ActivationFunction {
   Eigen::VectorXd operator()(const Eigen::VectorXd& input) const override {
-    return Eigen::maximum(input.array(), 0.0).matrix();
+    return input.cwiseMax(0.0);
+  }
+  Eigen::MatrixXd applyBatch(const Eigen::MatrixXd& inputs) const override {
+    return inputs.cwiseMax(0.0);
+  }
+  Eigen::VectorXd derivative(const Eigen::VectorXd& output) const override {
+    return (output.array() > 0.0).cast<double>();
+  }
+  std::unique_ptr<ActivationFunction> clone() const override {
+    return std::make_unique<ReLU>();
   }
 };
 
@@ -28,6 +55,9 @@ struct NeuralNetworkLayer {
   int outputSize;
   Eigen::MatrixXd weights;
   Eigen::VectorXd biases;
+  Eigen::MatrixXd weightGradients;
+  Eigen::VectorXd biasGradients;
+  double weightDecay = 0.0;
   std::unique_ptr<ActivationFunction> activation;
 
   NeuralNetworkLayer(int inputSize, int outputSize, std::unique_ptr<ActivationFunction> activation) :
@@ -38,6 +68,8 @@ struct NeuralNetworkLayer {
 
     weights = Eigen::MatrixXd::Random(outputSize, inputSize);
     biases = Eigen::VectorXd::Zero(outputSize);
+    weightGradients = Eigen::MatrixXd::Zero(outputSize, inputSize);
+    biasGradients = Eigen::VectorXd::Zero(outputSize);
 
     for (int i = 0; i < outputSize; ++i) {
       for (int j = 0; j < inputSize; ++j) {
@@ -46,6 +78,13 @@ struct NeuralNetworkLayer {
     }
   }
 
+  // Builds a layer from existing parameters (e.g. a loaded checkpoint) without random initialisation.
+  NeuralNetworkLayer(const Eigen::MatrixXd& weights, const Eigen::VectorXd& biases, std::unique_ptr<ActivationFunction> activation) :
+      inputSize(static_cast<int>(weights.cols())), outputSize(static_cast<int>(weights.rows())),
+      weights(weights), biases(biases),
+      weightGradients(Eigen::MatrixXd::Zero(weights.rows(), weights.cols())),
+      biasGradients(Eigen::VectorXd::Zero(biases.size())), activation(std::move(activation)) {}
+
   Eigen::VectorXd forward(const Eigen::VectorXd& input) const {
     Eigen::VectorXd output = weights * input + biases;
     return (*activation)(output); 
@@ -54,15 +93,19 @@ struct NeuralNetworkLayer {
 
 struct NeuralNetwork {
   int inputSize;
+  double dropoutRate = 0.0;
   std::vector<std::unique_ptr<NeuralNetworkLayer>> layers;
 
-  NeuralNetwork(int inputSize, const std::vector<int>& hiddenLayerSizes, std::unique_ptr<ActivationFunction> activation) :
+  explicit NeuralNetwork(int inputSize) : inputSize(inputSize) {}
+
+  NeuralNetwork(int inputSize, const std::vector<int>& hiddenLayerSizes, int outputSize,
+                std::unique_ptr<ActivationFunction> activation) :
       inputSize(inputSize) {
     for (int hiddenSize : hiddenLayerSizes) {
-      layers.push_back(std::make_unique<NeuralNetworkLayer>(inputSize, hiddenSize, std::move(activation->clone())));
+      layers.push_back(std::make_unique<NeuralNetworkLayer>(inputSize, hiddenSize, activation->clone()));
       inputSize = hiddenSize;
     }
-    layers.push_back(std::make_unique<NeuralNetworkLayer>(inputSize, /* output size */, std::make_unique<Sigmoid>()));
+    layers.push_back(std::make_unique<NeuralNetworkLayer>(inputSize, outputSize, std::make_unique<Sigmoid>()));
   }
 
   Eigen::VectorXd predict(const std::vector<double>& dataVector) const {
@@ -72,55 +115,68 @@ struct NeuralNetwork {
     }
     return activation;
   }
+
+  // Adds the squared-error gradients for one sample to each layer's weightGradients/biasGradients.
+  void backpropagate(const Eigen::VectorXd& input, const Eigen::VectorXd& target) {
+    std::vector<Eigen::VectorXd> activations;
+    activations.reserve(layers.size() + 1);
+    activations.push_back(input);
+    for (const auto& layer : layers) {
+      activations.push_back(layer->forward(activations.back()));
+    }
+
+    Eigen::VectorXd delta = (activations.back() - target).cwiseProduct(layers.back()->activation->derivative(activations.back()));
+    for (int layerIdx = static_cast<int>(layers.size()) - 1; layerIdx >= 0; --layerIdx) {
+      auto& layer = layers[layerIdx];
+      layer->weightGradients.noalias() += delta * activations[layerIdx].transpose();
+      layer->biasGradients += delta;
+      if (layerIdx > 0) {
+        delta = (layer->weights.transpose() * delta).cwiseProduct(layers[layerIdx - 1]->activation->derivative(activations[layerIdx]));
+      }
+    }
+  }
+
   void train(const std::vector<std::vector<double>>& dataVectors, const std::vector<std::vector<double>>& targets,
-             double learningRate) {
-    for (int epoch = 0; epoch < /* number of epochs */; ++epoch) {
+             double learningRate, int epochs = 1) {
+    static ProfileCounter& counter = profileCounter("NeuralNetwork::train");
+    ScopedTimer timer(counter);
+    for (int epoch = 0; epoch < epochs; ++epoch) {
       for (size_t i = 0; i < dataVectors.size(); ++i) {
         Eigen::VectorXd input = Eigen::Map<const Eigen::VectorXd>(dataVectors[i].data(), dataVectors[i].size());
         Eigen::VectorXd target = Eigen::Map<const Eigen::VectorXd>(targets[i].data(), targets[i].size());
 
-        Eigen::VectorXd activation = input;
-        std::vector<Eigen::VectorXd> activations; 
-        activations.push_back(activation);
-        for (const auto& layer : layers) {
-          activation = layer->forward(activation);
-          activations.push_back(activation);
-        }
-
-        Eigen::VectorXd outputError = activations.back() - target;
-        std::vector<Eigen::VectorXd> deltas;
-        deltas.push_back(outputError.array() * activations.back().array().deriv()); /
-        for (int layerIdx = layers.size() - 2; layerIdx >= 0; --layerIdx) {
-          const auto& layer = layers[layerIdx];
-          Eigen::VectorXd previousActivation = activations[layerIdx];
-          Eigen::VectorXd delta = layer->weights.transpose() * deltas.back().array() * previousActivation.array().deriv();
-          deltas.insert(deltas.begin(), delta);
-        }
-
-        for (int layerIdx = 0; layerIdx < layers.size(); ++layerIdx) {
-          auto& layer = layers[layerIdx];
-          layer->weights -= learningRate * deltas[layerIdx] * activations[layerIdx].transpose();
-          layer->biases -= learningRate * deltas[layerIdx];
+        backpropagate(input, target);
+        for (auto& layer : layers) {
+          layer->weights -= learningRate * layer->weightGradients;
+          layer->biases -= learningRate * layer->biasGradients;
+          layer->weightGradients.setZero();
+          layer->biasGradients.setZero();
         }
       }
+      timer.addItems(dataVectors.size());
     }
   }
 };
 
+#if __INCLUDE_LEVEL__ == 0
 int main() {
   
   std::vector<DataPoint> preprocessedPoints = {/* preprocessed data points */};
 
   int vectorDimension = 1000;
 
-  std::vector<std::vector<double>> dataVectors = vectorizeDataRandomProjection(preprocessedPoints, vectorDimension);
+  std::vector<int> documentFrequencies = {/* document frequencies for each value */};
+
+  std::vector<std::vector<double>> dataVectors = vectorizeDataRandomProjection(preprocessedPoints, vectorDimension, documentFrequencies);
 
   std::unique_ptr<MerkleTreeNode> root = constructMerkleTree(dataVectors);
 
   int inputSize = vectorDimension;
   int hiddenSize = 500;
-  int outputSize = /* number of output classes */
-  NeuralNetwork net(inputSize, hiddenSize, outputSize);
+  int outputSize = 10; // number of output classes
+  NeuralNetwork net(inputSize, {hiddenSize}, outputSize, std::make_unique<ReLU>());
   
   return 0;
 }
+#endif
+#endif
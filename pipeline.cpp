@@ -0,0 +1,468 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <type_traits>
+#include <stdexcept>
+#include <cstdint>
+#include "trainer.cpp"
+
+// Blocking FIFO with a fixed capacity, so a fast producer is throttled by a slow consumer instead of
+// buffering the whole dataset. close() lets consumers drain what is left; abort() wakes everyone
+// and drops remaining items (used for cancellation).
+template <typename T>
+struct BoundedChannel {
+  std::mutex mutex;
+  std::condition_variable notEmpty;
+  std::condition_variable notFull;
+  std::deque<T> items;
+  size_t capacity;
+  bool closed = false;
+  bool aborted = false;
+
+  explicit BoundedChannel(size_t capacity) : capacity(capacity) {
+    if (capacity == 0) {
+      throw std::invalid_argument("Channel capacity must be positive");
+    }
+  }
+
+  bool push(T value) {
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [this] { return items.size() < capacity || closed || aborted; });
+    if (closed || aborted) {
+      return false;
+    }
+    items.push_back(std::move(value));
+    notEmpty.notify_one();
+    return true;
+  }
+
+  // Returns false once the channel is closed and drained, or aborted.
+  bool pop(T& value) {
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [this] { return !items.empty() || closed || aborted; });
+    if (aborted || items.empty()) {
+      return false;
+    }
+    value = std::move(items.front());
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    notEmpty.notify_all();
+    notFull.notify_all();
+  }
+
+  void abort() {
+    std::lock_guard<std::mutex> lock(mutex);
+    aborted = true;
+    items.clear();
+    notEmpty.notify_all();
+    notFull.notify_all();
+  }
+};
+
+struct PipelineStageStats {
+  std::string name;
+  int parallelism;
+  std::atomic<uint64_t> itemsProcessed{0};
+  std::atomic<uint64_t> recordsProcessed{0};
+  std::atomic<uint64_t> busyNanos{0};
+  std::atomic<uint64_t> inputWaitNanos{0};
+  std::atomic<uint64_t> outputWaitNanos{0};
+
+  PipelineStageStats(const std::string& name, int parallelism) : name(name), parallelism(parallelism) {}
+};
+
+// How many records an item carries, for the per-stage records/s counters. Items are single records
+// unless specialised (chunked items report their chunk size).
+template <typename T>
+struct PipelineItemTraits {
+  static uint64_t records(const T&) { return 1; }
+};
+
+uint64_t nanosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs a chain of stages concurrently, each on its own worker threads, connected by bounded channels.
+// Stages start as soon as they are added.
+//
+// Error model: the first exception thrown by any stage is recorded, every channel is aborted so all
+// workers unwind promptly, and wait() rethrows that exception. cancel() does the same without an
+// error. Items already in flight when a pipeline is cancelled are dropped. A stage with parallelism
+// > 1 may emit items out of order; stages that care (e.g. Merkle root assembly) key on chunk index.
+struct Pipeline {
+  std::atomic<bool> cancelled{false};
+  std::mutex errorMutex;
+  std::exception_ptr firstError;
+  std::vector<std::function<void()>> abortHooks;
+  std::vector<std::thread> threads;
+  std::vector<std::unique_ptr<PipelineStageStats>> stages;
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+  Pipeline() = default;
+  Pipeline(const Pipeline&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+
+  ~Pipeline() {
+    cancel();
+    joinAll();
+  }
+
+  template <typename Out, typename Produce>
+  std::shared_ptr<BoundedChannel<Out>> addSource(const std::string& name, Produce produce, size_t capacity) {
+    auto output = makeChannel<Out>(capacity);
+    PipelineStageStats* stats = addStats(name, 1);
+    threads.emplace_back([this, output, stats, produce]() mutable {
+      try {
+        while (!cancelled.load()) {
+          auto busyStart = std::chrono::steady_clock::now();
+          Out item;
+          if (!produce(item)) {
+            break;
+          }
+          stats->busyNanos += nanosSince(busyStart);
+          stats->itemsProcessed++;
+          stats->recordsProcessed += PipelineItemTraits<Out>::records(item);
+
+          auto waitStart = std::chrono::steady_clock::now();
+          if (!output->push(std::move(item))) {
+            break;
+          }
+          stats->outputWaitNanos += nanosSince(waitStart);
+        }
+      } catch (...) {
+        fail(std::current_exception());
+      }
+      output->close();
+    });
+    return output;
+  }
+
+  template <typename In, typename Transform, typename Out = std::invoke_result_t<Transform&, In&&>>
+  std::shared_ptr<BoundedChannel<Out>> addStage(const std::string& name, std::shared_ptr<BoundedChannel<In>> input,
+                                                Transform transform, int parallelism, size_t capacity) {
+    if (parallelism < 1) {
+      throw std::invalid_argument("Stage parallelism must be at least 1");
+    }
+    auto output = makeChannel<Out>(capacity);
+    PipelineStageStats* stats = addStats(name, parallelism);
+    auto remainingWorkers = std::make_shared<std::atomic<int>>(parallelism);
+
+    for (int w = 0; w < parallelism; ++w) {
+      threads.emplace_back([this, input, output, stats, transform, remainingWorkers]() mutable {
+        try {
+          while (true) {
+            auto waitStart = std::chrono::steady_clock::now();
+            In item;
+            if (!input->pop(item)) {
+              break;
+            }
+            stats->inputWaitNanos += nanosSince(waitStart);
+
+            auto busyStart = std::chrono::steady_clock::now();
+            uint64_t records = PipelineItemTraits<In>::records(item);
+            Out result = transform(std::move(item));
+            stats->busyNanos += nanosSince(busyStart);
+            stats->itemsProcessed++;
+            stats->recordsProcessed += records;
+
+            waitStart = std::chrono::steady_clock::now();
+            if (!output->push(std::move(result))) {
+              break;
+            }
+            stats->outputWaitNanos += nanosSince(waitStart);
+          }
+        } catch (...) {
+          fail(std::current_exception());
+        }
+        if (--*remainingWorkers == 0) {
+          output->close();
+        }
+      });
+    }
+    return output;
+  }
+
+  template <typename In, typename Consume>
+  void addSink(const std::string& name, std::shared_ptr<BoundedChannel<In>> input, Consume consume) {
+    PipelineStageStats* stats = addStats(name, 1);
+    threads.emplace_back([this, input, stats, consume]() mutable {
+      try {
+        while (true) {
+          auto waitStart = std::chrono::steady_clock::now();
+          In item;
+          if (!input->pop(item)) {
+            break;
+          }
+          stats->inputWaitNanos += nanosSince(waitStart);
+
+          auto busyStart = std::chrono::steady_clock::now();
+          uint64_t records = PipelineItemTraits<In>::records(item);
+          consume(std::move(item));
+          stats->busyNanos += nanosSince(busyStart);
+          stats->itemsProcessed++;
+          stats->recordsProcessed += records;
+        }
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    });
+  }
+
+  void cancel() {
+    if (cancelled.exchange(true)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(errorMutex);
+    for (auto& abortChannel : abortHooks) {
+      abortChannel();
+    }
+  }
+
+  void fail(std::exception_ptr error) {
+    {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!firstError) {
+        firstError = error;
+      }
+    }
+    cancel();
+  }
+
+  // Blocks until every stage has finished and rethrows the first stage error, if any.
+  void wait() {
+    joinAll();
+    if (firstError) {
+      std::rethrow_exception(firstError);
+    }
+  }
+
+  void printStats(std::ostream& out) const {
+    double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    out << "Pipeline Statistics (" << elapsedSeconds << " s):" << std::endl;
+    for (const auto& stage : stages) {
+      uint64_t items = stage->itemsProcessed.load();
+      uint64_t records = stage->recordsProcessed.load();
+      out << stage->name << " [x" << stage->parallelism << "]: " << items << " items (" << records << " records), "
+          << (elapsedSeconds > 0 ? items / elapsedSeconds : 0.0) << " items/s, "
+          << (elapsedSeconds > 0 ? records / elapsedSeconds : 0.0) << " records/s, busy "
+          << stage->busyNanos.load() / 1e9 << " s, waiting for input " << stage->inputWaitNanos.load() / 1e9
+          << " s, waiting for output " << stage->outputWaitNanos.load() / 1e9 << " s" << std::endl;
+    }
+  }
+
+ private:
+  template <typename T>
+  std::shared_ptr<BoundedChannel<T>> makeChannel(size_t capacity) {
+    auto channel = std::make_shared<BoundedChannel<T>>(capacity);
+    std::lock_guard<std::mutex> lock(errorMutex);
+    abortHooks.push_back([channel] { channel->abort(); });
+    if (cancelled.load()) {
+      channel->abort();
+    }
+    return channel;
+  }
+
+  PipelineStageStats* addStats(const std::string& name, int parallelism) {
+    stages.push_back(std::make_unique<PipelineStageStats>(name, parallelism));
+    return stages.back().get();
+  }
+
+  void joinAll() {
+    for (auto& thread : threads) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+  }
+};
+
+struct DataChunk {
+  size_t index = 0;
+  size_t records = 0;
+  std::vector<DataPoint> points;
+  std::vector<std::vector<double>> dataVectors;
+  std::vector<std::vector<double>> targets;
+  std::vector<std::string> leafHashes;
+};
+
+template <>
+struct PipelineItemTraits<std::shared_ptr<DataChunk>> {
+  static uint64_t records(const std::shared_ptr<DataChunk>& chunk) { return chunk->records; }
+};
+
+// Concatenates the per-chunk leaf hashes in chunk order and builds the root over them. Only the
+// leaves are hashed per chunk; the inner nodes are built here with constructMerkleTree's split rule,
+// so the root is identical to constructMerkleTree over the whole dataset, whatever the chunk size.
+std::string combineChunkLeafHashes(const std::map<size_t, std::vector<std::string>>& chunkLeafHashes) {
+  std::vector<std::string> leafHashes;
+  for (const auto& entry : chunkLeafHashes) {
+    leafHashes.insert(leafHashes.end(), entry.second.begin(), entry.second.end());
+  }
+  if (leafHashes.empty()) {
+    throw std::runtime_error("No chunks were hashed");
+  }
+  return merkleRootFromLeafHashes(leafHashes);
+}
+
+// Streams the input file through load -> preprocess -> vectorize [-> hash] -> train once. Training is
+// streaming SGD: the sink runs a single pass (one trainNetwork epoch) over each chunk, so one call is
+// one epoch over the whole file. The parallel stages reorder chunks, so the sink holds early arrivals
+// back and trains strictly in chunk order, keeping the SGD sequence deterministic. Leaf hashes are
+// collected only when chunkLeafHashes is given. Returns false if the pipeline failed.
+bool runPipelineEpoch(const std::string& inputFilePath, size_t chunkSize, int vectorDimension,
+                      const std::vector<int>& documentFrequencies, NeuralNetwork& net, const Optimizer& optimizer,
+                      std::map<size_t, std::vector<std::string>>* chunkLeafHashes) {
+  std::ifstream infile(inputFilePath);
+  if (!infile.is_open()) {
+    std::cerr << "Error: Could not open file " << inputFilePath << std::endl;
+    return false;
+  }
+
+  Pipeline pipeline;
+  size_t nextChunkIndex = 0;
+
+  auto loaded = pipeline.addSource<std::shared_ptr<DataChunk>>("load", [&](std::shared_ptr<DataChunk>& chunk) {
+    chunk = std::make_shared<DataChunk>();
+    chunk->index = nextChunkIndex++;
+    chunk->points.reserve(chunkSize);
+    int num;
+    while (chunk->points.size() < chunkSize && infile >> num) {
+      chunk->points.push_back({num, 0.0});
+    }
+    // Extraction stops on a non-integer token as well as at EOF; only EOF is a clean end of input.
+    if (infile.fail() && !infile.eof()) {
+      throw std::runtime_error("Invalid token in " + inputFilePath + " at record " +
+                               std::to_string(chunk->index * chunkSize + chunk->points.size()));
+    }
+    chunk->records = chunk->points.size();
+    return !chunk->points.empty();
+  }, 4);
+
+  auto preprocessed = pipeline.addStage("preprocess", loaded, [](std::shared_ptr<DataChunk> chunk) {
+    for (const DataPoint& point : chunk->points) {
+      if (!validateNumber(point.raw_value)) {
+        throw std::runtime_error("Invalid value in chunk " + std::to_string(chunk->index) + ": " +
+                                 std::to_string(point.raw_value));
+      }
+    }
+    chunk->points = furtherPreprocess(chunk->points);
+    return chunk;
+  }, 2, 4);
+
+  auto vectorized = pipeline.addStage("vectorize", preprocessed, [&](std::shared_ptr<DataChunk> chunk) {
+    chunk->dataVectors = vectorizeDataRandomProjection(chunk->points, vectorDimension, documentFrequencies);
+    chunk->targets.reserve(chunk->points.size());
+    for (const DataPoint& point : chunk->points) {
+      chunk->targets.push_back({point.normalized_value});
+    }
+    chunk->points.clear();
+    return chunk;
+  }, 4, 4);
+
+  if (chunkLeafHashes) {
+    vectorized = pipeline.addStage("hash", vectorized, [](std::shared_ptr<DataChunk> chunk) {
+      chunk->leafHashes.reserve(chunk->dataVectors.size());
+      for (const auto& dataVector : chunk->dataVectors) {
+        chunk->leafHashes.push_back(hashDataVector(dataVector));
+      }
+      return chunk;
+    }, 4, 4);
+  }
+
+  // At most the chunks in flight upstream can arrive ahead of the next one, which bounds this map.
+  std::map<size_t, std::shared_ptr<DataChunk>> pendingChunks;
+  size_t nextChunkToTrain = 0;
+  pipeline.addSink("train", vectorized, [&](std::shared_ptr<DataChunk> chunk) {
+    if (chunkLeafHashes) {
+      (*chunkLeafHashes)[chunk->index] = std::move(chunk->leafHashes);
+    }
+    pendingChunks[chunk->index] = std::move(chunk);
+    for (auto it = pendingChunks.find(nextChunkToTrain); it != pendingChunks.end();
+         it = pendingChunks.find(nextChunkToTrain)) {
+      trainNetwork(net, it->second->dataVectors, it->second->targets, optimizer, /* batch size */ 32,
+                   /* learning rate */ 0.01, /* weight decay */ 0.0, /* epochs */ 1);
+      pendingChunks.erase(it);
+      ++nextChunkToTrain;
+    }
+  });
+
+  try {
+    pipeline.wait();
+  } catch (const std::exception& e) {
+    std::cerr << "Error: Pipeline failed: " << e.what() << std::endl;
+    pipeline.printStats(std::cerr);
+    return false;
+  }
+  pipeline.printStats(std::cout);
+  return true;
+}
+
+// First pass over the input: documentFrequencies[v - 1] is the number of chunks (documents) that
+// contain value v, for the vocabulary 1..100 that validateNumber accepts. Tokens that are not valid
+// values are left for the pipeline's load and preprocess stages to report.
+std::vector<int> computeDocumentFrequencies(const std::string& inputFilePath, size_t chunkSize) {
+  std::ifstream infile(inputFilePath);
+  if (!infile.is_open()) {
+    throw std::runtime_error("Could not open file " + inputFilePath);
+  }
+  std::vector<int> documentFrequencies(100, 0);
+  std::vector<size_t> lastChunkSeen(100, SIZE_MAX);
+  size_t position = 0;
+  int num;
+  while (infile >> num) {
+    size_t chunk = position++ / chunkSize;
+    if (validateNumber(num) && lastChunkSeen[num - 1] != chunk) {
+      lastChunkSeen[num - 1] = chunk;
+      documentFrequencies[num - 1]++;
+    }
+  }
+  return documentFrequencies;
+}
+
+int main() {
+  std::string inputFilePath = "numbers.txt";
+  size_t chunkSize = 4096;
+  int vectorDimension = 1000;
+  int epochs = 1;
+
+  std::vector<int> documentFrequencies;
+  try {
+    documentFrequencies = computeDocumentFrequencies(inputFilePath, chunkSize);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  NeuralNetwork net(vectorDimension, {500}, 1, std::make_unique<ReLU>());
+  SGD optimizer;
+  std::map<size_t, std::vector<std::string>> chunkLeafHashes;
+
+  // The Merkle root depends only on the data, so it is computed on the first epoch.
+  for (int epoch = 0; epoch < epochs; ++epoch) {
+    std::cout << "Epoch " << epoch + 1 << "/" << epochs << std::endl;
+    if (!runPipelineEpoch(inputFilePath, chunkSize, vectorDimension, documentFrequencies, net, optimizer,
+                          epoch == 0 ? &chunkLeafHashes : nullptr)) {
+      return 1;
+    }
+  }
+
+  std::cout << "Merkle root: " << combineChunkLeafHashes(chunkLeafHashes) << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,162 @@
+#ifndef PROFILER_CPP
+#define PROFILER_CPP
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <nlohmann/json.hpp>
+
+// Lightweight per-stage timers and counters. Profiling is off by default and costs one relaxed
+// atomic load per instrumented call; set MLX_PROFILE=<file> to enable it and have a JSON profile
+// written at exit, or call Profiler::instance().enable() and dump it yourself.
+
+struct ProfileCounter {
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> totalNanos{0};
+  std::atomic<uint64_t> maxNanos{0};
+  std::atomic<uint64_t> items{0};
+
+  void record(uint64_t nanos, uint64_t itemCount) {
+    calls.fetch_add(1, std::memory_order_relaxed);
+    totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+    items.fetch_add(itemCount, std::memory_order_relaxed);
+    uint64_t currentMax = maxNanos.load(std::memory_order_relaxed);
+    while (nanos > currentMax && !maxNanos.compare_exchange_weak(currentMax, nanos, std::memory_order_relaxed)) {
+    }
+  }
+
+  void reset() {
+    calls = 0;
+    totalNanos = 0;
+    maxNanos = 0;
+    items = 0;
+  }
+};
+
+struct Profiler {
+  std::atomic<bool> enabled{false};
+  std::string outputPath;
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<ProfileCounter>> counters;
+
+  static Profiler& instance() {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  Profiler() {
+    if (const char* path = std::getenv("MLX_PROFILE")) {
+      outputPath = path;
+      enabled = true;
+    }
+  }
+
+  ~Profiler() {
+    if (!outputPath.empty()) {
+      dumpJson(outputPath);
+    }
+  }
+
+  void enable() {
+    enabled.store(true, std::memory_order_relaxed);
+  }
+
+  void disable() {
+    enabled.store(false, std::memory_order_relaxed);
+  }
+
+  bool isEnabled() const {
+    return enabled.load(std::memory_order_relaxed);
+  }
+
+  // Counters are never removed, so call sites can cache the returned reference in a static.
+  ProfileCounter& counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = counters[name];
+    if (!slot) {
+      slot = std::make_unique<ProfileCounter>();
+    }
+    return *slot;
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : counters) {
+      entry.second->reset();
+    }
+  }
+
+  nlohmann::json toJson() {
+    std::lock_guard<std::mutex> lock(mutex);
+    nlohmann::json stages = nlohmann::json::object();
+    for (const auto& entry : counters) {
+      const ProfileCounter& counter = *entry.second;
+      uint64_t calls = counter.calls.load();
+      if (calls == 0) {
+        continue;
+      }
+      double totalSeconds = counter.totalNanos.load() / 1e9;
+      uint64_t items = counter.items.load();
+      stages[entry.first] = {
+          {"calls", calls},
+          {"total_ms", totalSeconds * 1e3},
+          {"mean_ms", totalSeconds * 1e3 / calls},
+          {"max_ms", counter.maxNanos.load() / 1e6},
+          {"items", items},
+          {"items_per_second", totalSeconds > 0 ? items / totalSeconds : 0.0},
+      };
+    }
+    return {{"stages", stages}};
+  }
+
+  void dumpJson(const std::string& filename) {
+    std::ofstream outfile(filename);
+    if (!outfile.is_open()) {
+      std::cerr << "Error: Could not open profile file " << filename << std::endl;
+      return;
+    }
+    outfile << toJson().dump(2) << std::endl;
+  }
+};
+
+ProfileCounter& profileCounter(const std::string& name) {
+  return Profiler::instance().counter(name);
+}
+
+// Times the enclosing scope into a counter when profiling is enabled. Usage:
+//   static ProfileCounter& counter = profileCounter("vectorize");
+//   ScopedTimer timer(counter, dataPoints.size());
+struct ScopedTimer {
+  ProfileCounter& counter;
+  uint64_t items;
+  bool active;
+  std::chrono::steady_clock::time_point start;
+
+  explicit ScopedTimer(ProfileCounter& counter, uint64_t items = 0) :
+      counter(counter), items(items), active(Profiler::instance().isEnabled()) {
+    if (active) {
+      start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedTimer() {
+    if (active) {
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      counter.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), items);
+    }
+  }
+
+  void addItems(uint64_t count) {
+    items += count;
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+#endif
@@ -1,65 +1,80 @@
+#ifndef TRAINER_CPP
+#define TRAINER_CPP
 #include <iostream>
 #include <vector>
-#include "neuralnetwork.cpp"
+#include <numeric>
+#include <algorithm>
+#include <random>
+#include "checkpoint.cpp"
 
 struct Optimizer {
+  virtual ~Optimizer() = default;
   virtual void update(NeuralNetwork& net, const std::vector<double>& learningRates) const = 0;
 };
 
 struct SGD : public Optimizer {
   void update(NeuralNetwork& net, const std::vector<double>& learningRates) const override {
     for (auto& layer : net.layers) {
-      layer->weights -= learningRates[0] * layer->weights.array() * layer->weightDecay;
-      layer->biases -= learningRates[0] * layer->biases.array();
+      layer->weights -= learningRates[0] * (layer->weightGradients + layer->weightDecay * layer->weights);
+      layer->biases -= learningRates[0] * layer->biasGradients;
     }
   }
 };
 
 struct Adam : public Optimizer {
-  void update(NeuralNetwork& net, const std::vector<double>& learningRates) const override {
+  void update(NeuralNetwork& /* net */, const std::vector<double>& /* learningRates */) const override {
   }
 };
 
 void trainNetwork(NeuralNetwork& net, const std::vector<std::vector<double>>& dataVectors,
                    const std::vector<std::vector<double>>& targets, const Optimizer& optimizer,
-                   int batchSize, double learningRate, double weightDecay = 0.0) {
+                   int batchSize, double learningRate, double weightDecay = 0.0, int epochs = 1,
+                   OptimizerState* resumeState = nullptr, AsyncCheckpointWriter* checkpointWriter = nullptr,
+                   const std::string& checkpointPath = "model.ckpt") {
+  static ProfileCounter& counter = profileCounter("trainNetwork");
+  ScopedTimer timer(counter);
   int numSamples = dataVectors.size();
-  for (int epoch = 0; epoch < /* number of epochs */; ++epoch) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    for (int i = 0; i < numSamples; ++i) {
-      std::swap(dataVectors[i], dataVectors[std::uniform_int_distribution<int>(0, numSamples - 1)(gen)]);
-      std::swap(targets[i], targets[std::uniform_int_distribution<int>(0, numSamples - 1)(gen)]);
-    }
+  // Pass the state restored by loadCheckpoint to resume; it is updated in place.
+  OptimizerState localState;
+  OptimizerState& optimizerState = resumeState ? *resumeState : localState;
+  bool latestCheckpointWritten = true;
+  for (auto& layer : net.layers) {
+    layer->weightDecay = weightDecay;
+  }
+
+  std::vector<int> order(numSamples);
+  std::iota(order.begin(), order.end(), 0);
+  std::random_device rd;
+  std::mt19937 gen(rd());
+
+  for (int epoch = 0; epoch < epochs; ++epoch) {
+    std::shuffle(order.begin(), order.end(), gen);
 
     for (int i = 0; i < numSamples; i += batchSize) {
-      std::vector<Eigen::VectorXd> activations;
-      std::vector<Eigen::VectorXd> errors;
-      for (int j = i; j < std::min(i + batchSize, numSamples); ++j) {
-        Eigen::VectorXd input = Eigen::Map<const Eigen::VectorXd>(dataVectors[j].data(), dataVectors[j].size());
-        Eigen::VectorXd activation = net.forward(input);
-        activations.push_back(activation);
+      int batchEnd = std::min(i + batchSize, numSamples);
+      for (auto& layer : net.layers) {
+        layer->weightGradients.setZero();
+        layer->biasGradients.setZero();
       }
-
-      Eigen::VectorXd outputError = activations.back() - Eigen::Map<const Eigen::VectorXd>(targets[i].data(), targets[i].size());
-      errors.push_back(outputError);
-      for (int layerIdx = net.layers.size() - 2; layerIdx >= 0; --layerIdx) {
-        const auto& layer = net.layers[layerIdx];
-        Eigen::VectorXd previousActivation = activations[layerIdx];
-        Eigen::VectorXd delta = layer->backpropagate(errors.back(), previousActivation);
-        errors.insert(errors.begin(), delta); 
+      for (int j = i; j < batchEnd; ++j) {
+        const std::vector<double>& dataVector = dataVectors[order[j]];
+        const std::vector<double>& target = targets[order[j]];
+        net.backpropagate(Eigen::Map<const Eigen::VectorXd>(dataVector.data(), dataVector.size()),
+                          Eigen::Map<const Eigen::VectorXd>(target.data(), target.size()));
+      }
+      for (auto& layer : net.layers) {
+        layer->weightGradients /= (batchEnd - i);
+        layer->biasGradients /= (batchEnd - i);
       }
 
+      // DropConnect on the update: each weight's gradient is dropped with probability dropoutRate
+      // and the survivors are rescaled to keep the expected step unchanged.
       if (net.dropoutRate > 0.0) {
-        std::random_device rd;
-        std::mt19937 dropoutGen(rd());
-        std::bernoulli_distribution dropout(1.0 - net.dropoutRate);
+        std::bernoulli_distribution keep(1.0 - net.dropoutRate);
         for (auto& layer : net.layers) {
-          for (int i = 0; i < layer->weights.rows(); ++i) {
-            for (int j = 0; j < layer->weights.cols(); ++j) {
-              if (dropout(dropoutGen)) {
-                layer->weights(i, j) = 0.0;
-              }
+          for (int row = 0; row < layer->weightGradients.rows(); ++row) {
+            for (int col = 0; col < layer->weightGradients.cols(); ++col) {
+              layer->weightGradients(row, col) = keep(gen) ? layer->weightGradients(row, col) / (1.0 - net.dropoutRate) : 0.0;
             }
           }
         }
@@ -68,21 +83,47 @@ void trainNetwork(NeuralNetwork& net, const std::vector<std::vector<double>>& da
       std::vector<double> learningRates = {learningRate};
     
       optimizer.update(net, learningRates);
+      ++optimizerState.step;
+    }
 
-      if (net.dropoutRate > 0.0) {
-        for (auto& layer : net.layers) {
-          layer->weights.array() *= 1.0 / (1.0 - net.dropoutRate); 
-        }
-      }
+    timer.addItems(numSamples);
+
+    if (checkpointWriter) {
+      latestCheckpointWritten = checkpointWriter->submit(net, optimizerState, checkpointPath);
     }
   }
+
+  // A snapshot skipped because the previous write was still running must not leave an older epoch
+  // on disk, so the final state is always submitted once the writer is free.
+  if (checkpointWriter && !latestCheckpointWritten) {
+    checkpointWriter->wait();
+    checkpointWriter->submit(net, optimizerState, checkpointPath);
+  }
 }
 
+#if __INCLUDE_LEVEL__ == 0
 int main() {
+  std::vector<std::vector<double>> dataVectors = {/* data vectors */};
+  std::vector<std::vector<double>> targets = {/* targets */};
+
+  int inputSize = 1000;
+  int outputSize = 10;
+  NeuralNetwork net(inputSize, {500}, outputSize, std::make_unique<ReLU>());
+  std::unique_ptr<Optimizer> optimizer = std::make_unique<SGD>();
+  int batchSize = 32;
+  double learningRate = 0.01;
+  double weightDecay = 0.0001;
+  int epochs = 10;
 
-  trainNetwork(net, dataVectors, targets, *optimizer, batchSize, learningRate, weightDecay);
+  OptimizerState optimizerState;
+  AsyncCheckpointWriter checkpointWriter;
+  trainNetwork(net, dataVectors, targets, *optimizer, batchSize, learningRate, weightDecay, epochs, &optimizerState,
+               &checkpointWriter);
+  checkpointWriter.wait();
 
   // ...
   
   return 0;
 }
+#endif
+#endif
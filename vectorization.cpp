@@ -1,3 +1,5 @@
+#ifndef VECTORIZATION_CPP
+#define VECTORIZATION_CPP
 #include <iostream>
 #include <vector>
 #include <string>
@@ -6,6 +8,7 @@
 #include <random> 
 
 #include "data_preprocessing.cpp" 
+#include "profiler.cpp"
 
 std::vector<double> generateRandomUnitVector(int dimension) {
   std::random_device rd;
@@ -29,35 +32,54 @@ std::vector<double> generateRandomUnitVector(int dimension) {
   return vector;
 }
 
-double tfIdfWeighting(const DataPoint& dataPoint, const std::vector<int>& documentFrequencies) {
+// termCount is how often the data point's value occurs in the data being vectorized (the document).
+double tfIdfWeighting(const DataPoint& dataPoint, int termCount, const std::vector<int>& documentFrequencies) {
   int rawValue = dataPoint.raw_value;
   int documentCount = documentFrequencies.size(); 
 
-  double termFrequency = static_cast<double>(/* count of rawValue in the data */) / dataPoint.raw_value;
+  if (rawValue < 1 || rawValue > documentCount || documentFrequencies[rawValue - 1] <= 0) {
+    throw std::out_of_range("No document frequency for value " + std::to_string(rawValue));
+  }
+
+  double termFrequency = static_cast<double>(termCount) / dataPoint.raw_value;
 
   double inverseDocumentFrequency = std::log2(static_cast<double>(documentCount) / documentFrequencies[rawValue - 1]);
 
   return termFrequency * inverseDocumentFrequency;
 }
 
-std::vector<double> vectorizeDataPointRandomProjection(const DataPoint& dataPoint, int dimension, const std::vector<int>& documentFrequencies) {
+std::vector<double> vectorizeDataPointRandomProjection(const DataPoint& dataPoint, int termCount, int dimension, const std::vector<int>& documentFrequencies) {
   std::vector<double> vector = generateRandomUnitVector(dimension);
 
-  double weight = tfIdfWeighting(dataPoint, documentFrequencies);
+  double weight = tfIdfWeighting(dataPoint, termCount, documentFrequencies);
 
   vector[0] = weight * dataPoint.raw_value;
 
   return vector;
 }
 
+// Treats dataPoints as one document: term counts are taken over it in a first pass, then every point
+// is weighted by its value's count.
 std::vector<std::vector<double>> vectorizeDataRandomProjection(const std::vector<DataPoint>& dataPoints, int dimension, const std::vector<int>& documentFrequencies) {
+  static ProfileCounter& counter = profileCounter("vectorizeDataRandomProjection");
+  ScopedTimer timer(counter, dataPoints.size());
+  std::vector<int> termCounts(documentFrequencies.size() + 1, 0);
+  for (const DataPoint& point : dataPoints) {
+    if (point.raw_value >= 1 && point.raw_value < static_cast<int>(termCounts.size())) {
+      termCounts[point.raw_value]++;
+    }
+  }
   std::vector<std::vector<double>> vectors;
+  vectors.reserve(dataPoints.size());
   for (const DataPoint& point : dataPoints) {
-    vectors.push_back(vectorizeDataPointRandomProjection(point, dimension, documentFrequencies));
+    // Values outside the vocabulary get a count of 0 here and are rejected by tfIdfWeighting.
+    int termCount = point.raw_value >= 1 && point.raw_value < static_cast<int>(termCounts.size()) ? termCounts[point.raw_value] : 0;
+    vectors.push_back(vectorizeDataPointRandomProjection(point, termCount, dimension, documentFrequencies));
   }
   return vectors;
 }
 
+#if __INCLUDE_LEVEL__ == 0
 int main() {
   std::vector<DataPoint> preprocessedPoints = {/* preprocessed data points */};
 
@@ -71,12 +93,12 @@ int main() {
   for (const std::vector<double>& vec : dataVectors) {
     std::cout << "[";
     for (double value : vec) {
-			std::cout << "[";
-	  for (double value : vec) {
-	    std::cout << value << ", "; 
-		 }
-	  std::cout << "]" << std::endl;
-	}
-
-	  return 0;
-	}
+      std::cout << value << ", ";
+    }
+    std::cout << "]" << std::endl;
+  }
+
+  return 0;
+}
+#endif
+#endif